@@ -8,13 +8,55 @@
 #include "freertos/event_groups.h"
 #include "esp_mac.h" // 包含 MACSTR 和 MAC2STR 宏的头文件
 #include "esp_sntp.h"
+#include "esp_timer.h"
 #include <time.h>
+#include "ap.h"
 
 static const char *TAG = "WIFI_APSTA";
 
 // 定义全局标志位（默认未通过网络同步）
 bool g_is_ntp_synced = false;
 
+// 后台配网任务状态，Wi-Fi 事件任务、定时器任务和 httpd 任务都会访问，用自旋锁保护
+static wifi_prov_status_t s_prov = { 0 };
+static portMUX_TYPE s_prov_lock = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t s_prov_timer = NULL;
+static wifi_prov_cb_t s_prov_cb = NULL;
+static void *s_prov_cb_arg = NULL;
+
+// 更新配网状态；只在任务仍在进行时生效（失败后再拿到 IP 也算成功），返回是否发生变化
+static bool wifi_prov_update(wifi_prov_state_t state, uint8_t reason, uint32_t ip)
+{
+    bool changed = false;
+    portENTER_CRITICAL(&s_prov_lock);
+    if (s_prov.state == WIFI_PROV_ASSOCIATING ||
+        (s_prov.state == WIFI_PROV_FAILED && state == WIFI_PROV_GOT_IP)) {
+        s_prov.state = state;
+        s_prov.reason = reason;
+        s_prov.ip = ip;
+        changed = true;
+    }
+    portEXIT_CRITICAL(&s_prov_lock);
+
+    if (changed) {
+        if (state != WIFI_PROV_ASSOCIATING && s_prov_timer) {
+            esp_timer_stop(s_prov_timer);
+        }
+        if (s_prov_cb) {
+            s_prov_cb(s_prov_cb_arg);
+        }
+    }
+    return changed;
+}
+
+// 配网超时：仍未拿到 IP 就判定失败
+static void wifi_prov_timeout_cb(void *arg)
+{
+    if (wifi_prov_update(WIFI_PROV_FAILED, 0, 0)) {
+        ESP_LOGW(TAG, "配网任务 #%lu 超时", (unsigned long)s_prov.job_id);
+    }
+}
+
 // 当 SNTP 成功获取到时间时的回调函数
 void time_sync_notification_cb(struct timeval *tv)
 {
@@ -39,12 +81,19 @@ static void wifi_event_handler(void* arg, esp_event_base_t event_base,
     if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
         esp_wifi_connect();
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
-        ESP_LOGI(TAG, "STA Disconnected. Trying to reconnect...");
+        wifi_event_sta_disconnected_t* event = (wifi_event_sta_disconnected_t*) event_data;
+        ESP_LOGI(TAG, "STA Disconnected (reason %d). Trying to reconnect...", event->reason);
         g_is_ntp_synced = false; // 断开连接时，恢复由浏览器控制时间的逻辑
+        // 下发新配置时主动断开产生的 ASSOC_LEAVE 不算配网失败
+        if (event->reason != WIFI_REASON_ASSOC_LEAVE &&
+            wifi_prov_update(WIFI_PROV_FAILED, event->reason, 0)) {
+            ESP_LOGW(TAG, "配网任务 #%lu 失败: %s", (unsigned long)s_prov.job_id, wifi_prov_reason_name(event->reason));
+        }
         esp_wifi_connect();
     } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
         ip_event_got_ip_t* event = (ip_event_got_ip_t*) event_data;
         ESP_LOGI(TAG, "STA Connected! Got IP: " IPSTR, IP2STR(&event->ip_info.ip));
+        wifi_prov_update(WIFI_PROV_GOT_IP, 0, event->ip_info.ip.addr);
 
         // 启动 NTP 时间同步（仅初始化一次）
         if (!esp_sntp_enabled()) {
@@ -132,4 +181,76 @@ void wifi_init_softap()// 配置 Wi-Fi 为 AP+STA 模式
 
     ESP_LOGI(TAG, "Wi-Fi AP+STA started.");
     ESP_LOGI(TAG, "AP SSID: %s, password: %s", ap_config.ap.ssid, ap_config.ap.password);
-}
\ No newline at end of file
+}
+
+uint32_t wifi_prov_start(const char *ssid, const char *password)
+{
+    if (s_prov_timer == NULL) {
+        const esp_timer_create_args_t args = {
+            .callback = wifi_prov_timeout_cb,
+            .name = "wifi_prov",
+        };
+        esp_timer_create(&args, &s_prov_timer);
+    }
+
+    portENTER_CRITICAL(&s_prov_lock);
+    uint32_t job_id = ++s_prov.job_id;
+    s_prov.state = WIFI_PROV_ASSOCIATING;
+    s_prov.reason = 0;
+    s_prov.ip = 0;
+    portEXIT_CRITICAL(&s_prov_lock);
+
+    // 应用新的 STA 配置
+    wifi_config_t sta_config = {0};
+    strncpy((char *)sta_config.sta.ssid, ssid, sizeof(sta_config.sta.ssid) - 1);
+    strncpy((char *)sta_config.sta.password, password, sizeof(sta_config.sta.password) - 1);
+
+    // 断开现有的连接 -> 重新设置参数 -> 重新连接，结果由事件回调异步更新
+    esp_timer_stop(s_prov_timer);
+    esp_timer_start_once(s_prov_timer, (uint64_t)WIFI_PROV_TIMEOUT_MS * 1000);
+    esp_wifi_disconnect();
+    esp_wifi_set_config(WIFI_IF_STA, &sta_config);
+    esp_wifi_connect();
+
+    ESP_LOGI(TAG, "配网任务 #%lu 已开始, SSID: %s", (unsigned long)job_id, ssid);
+    if (s_prov_cb) {
+        s_prov_cb(s_prov_cb_arg);
+    }
+    return job_id;
+}
+
+void wifi_prov_get_status(wifi_prov_status_t *status)
+{
+    portENTER_CRITICAL(&s_prov_lock);
+    *status = s_prov;
+    portEXIT_CRITICAL(&s_prov_lock);
+}
+
+const char *wifi_prov_state_name(wifi_prov_state_t state)
+{
+    switch (state) {
+    case WIFI_PROV_ASSOCIATING: return "associating";
+    case WIFI_PROV_GOT_IP:      return "got_ip";
+    case WIFI_PROV_FAILED:      return "failed";
+    default:                    return "idle";
+    }
+}
+
+const char *wifi_prov_reason_name(uint8_t reason)
+{
+    switch (reason) {
+    case 0:                                  return "timeout";
+    case WIFI_REASON_AUTH_FAIL:
+    case WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT:
+    case WIFI_REASON_HANDSHAKE_TIMEOUT:      return "auth_failed";
+    case WIFI_REASON_NO_AP_FOUND:            return "no_ap_found";
+    case WIFI_REASON_CONNECTION_FAIL:        return "connection_failed";
+    default:                                 return "disconnected";
+    }
+}
+
+void wifi_prov_register_cb(wifi_prov_cb_t cb, void *arg)
+{
+    s_prov_cb_arg = arg;
+    s_prov_cb = cb;
+}
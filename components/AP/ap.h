@@ -2,9 +2,45 @@
 #define AP_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 extern bool g_is_ntp_synced;
 
 void wifi_init_softap(void);
 
+// ===== 后台配网任务 =====
+// 网页下发新的 STA 配置后，连接过程在后台进行，进度通过状态查询或回调获得
+
+// 配网任务状态
+typedef enum {
+    WIFI_PROV_IDLE = 0,     // 没有配网任务
+    WIFI_PROV_ASSOCIATING,  // 正在连接路由器
+    WIFI_PROV_GOT_IP,       // 已连接并获得 IP
+    WIFI_PROV_FAILED,       // 连接失败（见 reason）
+} wifi_prov_state_t;
+
+typedef struct {
+    uint32_t job_id;         // 任务编号，每次下发配置加 1
+    wifi_prov_state_t state;
+    uint8_t reason;          // 失败时的 Wi-Fi 断开原因码，超时为 0
+    uint32_t ip;             // 获得的 IPv4 地址（网络字节序）
+} wifi_prov_status_t;
+
+// 配网超时时间
+#define WIFI_PROV_TIMEOUT_MS 20000
+
+// 应用新的 STA 配置并在后台连接，立即返回任务编号
+uint32_t wifi_prov_start(const char *ssid, const char *password);
+
+// 获取当前配网任务状态
+void wifi_prov_get_status(wifi_prov_status_t *status);
+
+// 状态名与失败原因的文字描述，用于组装 JSON
+const char *wifi_prov_state_name(wifi_prov_state_t state);
+const char *wifi_prov_reason_name(uint8_t reason);
+
+// 配网状态变化回调，在 Wi-Fi 事件任务或定时器任务中调用，回调内不要做耗时操作
+typedef void (*wifi_prov_cb_t)(void *arg);
+void wifi_prov_register_cb(wifi_prov_cb_t cb, void *arg);
+
 #endif // AP_H
\ No newline at end of file
@@ -4,11 +4,14 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
+#include "esp_heap_caps.h"
 #include "esp_rom_sys.h"
 #include "nvs_flash.h"
 #include "nvs.h"
 #include "data_process.h"
 #include "dht11_rmt.h" // 引入 RMT 驱动
+#include "metrics.h"
+#include "trace.h"
 
 #define DHT11_GPIO 7  // DHT11引脚定义
 const static char *TAG = "DHT11";
@@ -29,11 +32,75 @@ static const char* NVS_NAMESPACE = "history";
 // 实时温度 湿度buffer
 static uint8_t buffer[5];
 
+// 有效采样序号，与样本缓冲一起由 sample_ring_lock 保护
+static uint32_t sample_seq = 0;
+
+// 数据版本号：今日极值变化 / 历史数组滚动时加 1，推送端据此只发送变化的部分
+static volatile uint32_t today_gen = 0;
+static volatile uint32_t history_gen = 1;
+
+// 最近样本环形缓冲：采集任务写，httpd 任务读，用自旋锁保护
+static sample_record_t *sample_ring = NULL;
+static uint32_t sample_ring_count = 0;   // 已存样本数（不超过 SAMPLE_RING_LEN）
+static uint32_t sample_ring_head = 0;    // 下一条写入的位置
+// 原始层只取环中最新的这么多条：时钟同步之后、按时间有序的部分（环本身仍按序号保存全部样本，供续传）
+static uint32_t series_raw_count = 0;
+static portMUX_TYPE sample_ring_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// 原始样本的间隔（秒），与采集任务的周期一致
+#define SERIES_RAW_STEP 2
+// 早于 2021-01-01 的时间说明时钟还没同步过（与跨天结算的判断一致），这样的样本不进曲线
+#define SERIES_MIN_TS 1609459200u
+
+// 均值层：环形缓冲 + 正在累加的时间桶，写入与读取同样由 sample_ring_lock 保护
+typedef struct {
+    series_point_t *buf;
+    uint32_t len;
+    uint32_t step;          // 时间桶宽度（秒）
+    uint32_t count;
+    uint32_t head;
+    uint32_t bucket_ts;     // 正在累加的桶起点
+    uint32_t bucket_n;      // 桶内已累加的样本数
+    int32_t temp_sum;
+    uint32_t hum_sum;
+} series_rollup_t;
+
+// 下标为 tier - 1
+static series_rollup_t rollups[SERIES_TIER_COUNT - 1] = {
+    { .len = SERIES_1M_LEN,  .step = 60 },
+    { .len = SERIES_15M_LEN, .step = 900 },
+};
+
+// 采样周期通知回调（由 Webserver 注册，用于主动推送）
+static data_process_notify_cb_t notify_cb = NULL;
+static void *notify_arg = NULL;
+
 // DHT11 初始化引脚，等待1s上电时间
 void data_process_init()
 {
     // 初始化 RMT 底层驱动代替原有的 GPIO 手动配置
     dht11_rmt_init((gpio_num_t)DHT11_GPIO);
+
+    // 样本缓冲约 21 KB，优先放 PSRAM，不占内部 RAM
+    sample_ring = heap_caps_calloc(SAMPLE_RING_LEN, sizeof(sample_record_t), MALLOC_CAP_SPIRAM);
+    if (sample_ring == NULL) {
+        sample_ring = heap_caps_calloc(SAMPLE_RING_LEN, sizeof(sample_record_t), MALLOC_CAP_DEFAULT);
+    }
+    if (sample_ring == NULL) {
+        ESP_LOGE(TAG, "样本缓冲分配失败，断线续传不可用");
+    }
+
+    // 均值层合计约 17 KB，同样放 PSRAM
+    for (int i = 0; i < SERIES_TIER_COUNT - 1; i++) {
+        series_rollup_t *r = &rollups[i];
+        r->buf = heap_caps_calloc(r->len, sizeof(series_point_t), MALLOC_CAP_SPIRAM);
+        if (r->buf == NULL) {
+            r->buf = heap_caps_calloc(r->len, sizeof(series_point_t), MALLOC_CAP_DEFAULT);
+        }
+        if (r->buf == NULL) {
+            ESP_LOGE(TAG, "%lu 秒均值缓冲分配失败", (unsigned long)r->step);
+        }
+    }
     
     // 从NVS中读取数据
     nvs_handle_t my_handle;
@@ -61,7 +128,9 @@ static void save_history_to_nvs() {
     if (err == ESP_OK) {
         nvs_set_blob(my_handle, "history", history_data, sizeof(history_data));
         nvs_set_i32(my_handle, "last_weekday", last_processed_weekday);
-        nvs_commit(my_handle);
+        TRACE_BEGIN(TRACE_NVS_COMMIT);
+        METRICS_INC(nvs_commit(my_handle) == ESP_OK ? METRIC_NVS_COMMITS : METRIC_NVS_COMMIT_ERRORS);
+        TRACE_END(TRACE_NVS_COMMIT);
         nvs_close(my_handle);
         ESP_LOGI(TAG, "数据已保存到 NVS");
     } else {
@@ -69,16 +138,101 @@ static void save_history_to_nvs() {
     }
 }
 
+// 把一个样本累加进均值层，跨过时间桶边界时把上一个桶的均值写入环中（调用者持有 sample_ring_lock）
+static void rollup_add(series_rollup_t *r, const sample_record_t *rec)
+{
+    if (r->buf == NULL) {
+        return;
+    }
+    uint32_t bucket = rec->ts - rec->ts % r->step;
+    if (r->bucket_n > 0 && bucket != r->bucket_ts) {
+        int32_t n = (int32_t)r->bucket_n;
+        series_point_t p = {
+            .ts = r->bucket_ts,
+            .temp_x10 = (int16_t)((r->temp_sum + (r->temp_sum >= 0 ? n / 2 : -n / 2)) / n),
+            .hum_x10 = (uint16_t)((r->hum_sum + n / 2) / n),
+        };
+        r->buf[r->head] = p;
+        r->head = (r->head + 1) % r->len;
+        if (r->count < r->len) {
+            r->count++;
+        }
+        r->bucket_n = 0;
+    }
+    if (r->bucket_n == 0) {
+        r->bucket_ts = bucket;
+        r->temp_sum = 0;
+        r->hum_sum = 0;
+    }
+    r->temp_sum += rec->temp_x10;
+    r->hum_sum += rec->hum_x10;
+    r->bucket_n++;
+}
+
+// 时钟还没同步或被往回调时清空三层曲线：各层都按时间二分查找，必须保持有序，
+// 且三层一起清空，选层时不会拿某一层残留的旧时间当作最早时间（调用者持有 sample_ring_lock）
+static void series_feed(const sample_record_t *rec)
+{
+    uint32_t last_ts = series_raw_count ?
+        sample_ring[(sample_ring_head + SAMPLE_RING_LEN - 2) % SAMPLE_RING_LEN].ts : 0;
+    if (rec->ts < SERIES_MIN_TS || rec->ts < last_ts) {
+        series_raw_count = 0;
+        for (int i = 0; i < SERIES_TIER_COUNT - 1; i++) {
+            rollups[i].count = 0;
+            rollups[i].head = 0;
+            rollups[i].bucket_n = 0;
+        }
+        if (rec->ts < SERIES_MIN_TS) {
+            return;
+        }
+    }
+    if (series_raw_count < SAMPLE_RING_LEN) {
+        series_raw_count++;
+    }
+    for (int i = 0; i < SERIES_TIER_COUNT - 1; i++) {
+        rollup_add(&rollups[i], rec);
+    }
+}
+
+// 把刚更新的实时读数记入样本缓冲并分配采样序号。
+// 序号与样本在同一个临界区内发布，读者看到序号 N 时第 N 条样本一定已经可读
+static void sample_ring_push(void)
+{
+    if (sample_ring == NULL) {
+        portENTER_CRITICAL(&sample_ring_lock);
+        sample_seq++;
+        portEXIT_CRITICAL(&sample_ring_lock);
+        return;
+    }
+    sample_record_t rec = {
+        .ts = (uint32_t)time(NULL),
+        .temp_x10 = (int16_t)(buffer[2] * 10 + buffer[3]),
+        .hum_x10 = (uint16_t)(buffer[0] * 10 + buffer[1]),
+    };
+    portENTER_CRITICAL(&sample_ring_lock);
+    rec.seq = ++sample_seq;
+    sample_ring[sample_ring_head] = rec;
+    sample_ring_head = (sample_ring_head + 1) % SAMPLE_RING_LEN;
+    if (sample_ring_count < SAMPLE_RING_LEN) {
+        sample_ring_count++;
+    }
+    series_feed(&rec);
+    portEXIT_CRITICAL(&sample_ring_lock);
+}
+
 // DHT11 任务函数
 static void data_process_task(void *pvParameters)
 {
     while (1)
     {
         dht11_reading_t rmt_data;
+        int64_t read_start = esp_timer_get_time();
         esp_err_t result = dht11_rmt_read(&rmt_data);
+        METRICS_OBSERVE(METRIC_HIST_SENSOR_READ, (uint32_t)(esp_timer_get_time() - read_start));
         
         if (result == ESP_OK)
         {
+            METRICS_INC(METRIC_SENSOR_READ_OK);
             // 最大最小值检测
 
             // 定义上一次的有效读数，用于对比
@@ -91,10 +245,12 @@ static void data_process_task(void *pvParameters)
             float hum = rmt_data.humidity;
 
             //异常值过滤
+            TRACE_BEGIN(TRACE_FILTER);
             if(last_valid_temp != -999.0){
                 if (abs(temp - last_valid_temp) >10.0 || abs(hum - last_valid_hum) > 30.0)
                 {
                     ESP_LOGW(TAG, "突发数据异常：温度 %.1f, 湿度 %.1f，已过滤", temp, hum);
+                    METRICS_INC(METRIC_SENSOR_FILTERED);
                     valid = false;
                 }
             }
@@ -114,25 +270,31 @@ static void data_process_task(void *pvParameters)
                     ESP_LOGW(TAG, "使用上次有效数据：温度 %.1f, 湿度 %.1f", temp, hum);
                 }
             }
+            TRACE_END(TRACE_FILTER);
             
             // 更新缓存（放在异常值处理之后，保证 Web 端拿到的也是清洗后的安全数据！）
             buffer[2] = (int)temp;                           // 温度整数
             buffer[3] = (int)((temp - buffer[2]) * 10);      // 温度小数
             buffer[0] = (int)hum;                            // 湿度整数
             buffer[1] = (int)((hum - buffer[0]) * 10);       // 湿度小数
+            sample_ring_push();
 
-            //最值对比
+            //最值对比，跨天结算
+            TRACE_BEGIN(TRACE_ROLLUP);
             if (first_read) {
                 curr_max_temp = temp;
                 curr_min_temp = temp;
                 curr_max_hum = hum;
                 curr_min_hum = hum;
                 first_read = false;
+                today_gen++;
             } else {
-                if (temp > curr_max_temp) curr_max_temp = temp;
-                if (temp < curr_min_temp) curr_min_temp = temp;
-                if (hum > curr_max_hum) curr_max_hum = hum;
-                if (hum < curr_min_hum) curr_min_hum = hum;
+                bool changed = false;
+                if (temp > curr_max_temp) { curr_max_temp = temp; changed = true; }
+                if (temp < curr_min_temp) { curr_min_temp = temp; changed = true; }
+                if (hum > curr_max_hum) { curr_max_hum = hum; changed = true; }
+                if (hum < curr_min_hum) { curr_min_hum = hum; changed = true; }
+                if (changed) today_gen++;
             }
 
             //时间同步检测
@@ -172,6 +334,7 @@ static void data_process_task(void *pvParameters)
 
                     // 保存
                     last_processed_weekday = today;
+                    history_gen++;
                     save_history_to_nvs();
                     first_read = true; // 新的一天，重置极值
 
@@ -180,11 +343,18 @@ static void data_process_task(void *pvParameters)
                     }
                 }
             }
+            TRACE_END(TRACE_ROLLUP);
         }
         else
         {
+            METRICS_INC(METRIC_SENSOR_READ_FAIL);
             ESP_LOGE(TAG, "Reading data failed.");
         }
+
+        // 无论本轮是否读到新数据都通知一次，推送端借此保持固定心跳节奏
+        if (notify_cb) {
+            notify_cb(notify_arg);
+        }
         vTaskDelay(2000 / portTICK_PERIOD_MS);
     }
 }
@@ -220,6 +390,34 @@ int get_humidity_dec(void)
     return buffer[1];
 }
 
+// 获取采样序号
+uint32_t get_sample_seq(void)
+{
+    portENTER_CRITICAL(&sample_ring_lock);
+    uint32_t seq = sample_seq;
+    portEXIT_CRITICAL(&sample_ring_lock);
+    return seq;
+}
+
+// 获取今日极值版本号
+uint32_t get_today_gen(void)
+{
+    return today_gen;
+}
+
+// 获取历史数据版本号
+uint32_t get_history_gen(void)
+{
+    return history_gen;
+}
+
+// 注册采样周期通知回调（只支持一个订阅者）
+void data_process_register_notify(data_process_notify_cb_t cb, void *arg)
+{
+    notify_arg = arg;
+    notify_cb = cb;
+}
+
 // 获取今日最大最小值
 void get_today_stats(float *max_t, float *min_t, float *max_h, float *min_h)
 {
@@ -236,4 +434,107 @@ void get_weekly_history(DailyData *history_array)
     if (history_array != NULL) {
         memcpy(history_array, history_data, sizeof(history_data));
     }
-}
\ No newline at end of file
+}
+
+// 读取序号大于 after_seq 的最近样本
+int get_samples_since(uint32_t after_seq, sample_record_t *out, int max, uint32_t *oldest_seq)
+{
+    int n = 0;
+    portENTER_CRITICAL(&sample_ring_lock);
+    uint32_t count = sample_ring_count;
+    uint32_t newest = count ? sample_ring[(sample_ring_head + SAMPLE_RING_LEN - 1) % SAMPLE_RING_LEN].seq : 0;
+    uint32_t oldest = count ? newest - count + 1 : 0;
+    if (count && (int32_t)(newest - after_seq) > 0) {
+        // 序号连续，可直接由序号换算出在环中的位置
+        uint32_t start = (int32_t)(after_seq + 1 - oldest) > 0 ? after_seq + 1 : oldest;
+        uint32_t avail = newest - start + 1;
+        n = avail < (uint32_t)max ? (int)avail : max;
+        uint32_t pos = (sample_ring_head + SAMPLE_RING_LEN - (newest - start + 1)) % SAMPLE_RING_LEN;
+        for (int i = 0; i < n; i++) {
+            out[i] = sample_ring[(pos + i) % SAMPLE_RING_LEN];
+        }
+    }
+    portEXIT_CRITICAL(&sample_ring_lock);
+    if (oldest_seq) {
+        *oldest_seq = oldest;
+    }
+    return n;
+}
+
+bool get_latest_sample(sample_record_t *out)
+{
+    bool ok = false;
+    portENTER_CRITICAL(&sample_ring_lock);
+    if (sample_ring_count) {
+        *out = sample_ring[(sample_ring_head + SAMPLE_RING_LEN - 1) % SAMPLE_RING_LEN];
+        ok = true;
+    }
+    portEXIT_CRITICAL(&sample_ring_lock);
+    return ok;
+}
+
+// 某一层第 i 个点（按时间从旧到新，i < count），调用者持有 sample_ring_lock
+static series_point_t series_at(series_tier_t tier, uint32_t i)
+{
+    if (tier == SERIES_TIER_RAW) {
+        const sample_record_t *rec =
+            &sample_ring[(sample_ring_head + SAMPLE_RING_LEN - series_raw_count + i) % SAMPLE_RING_LEN];
+        series_point_t p = { .ts = rec->ts, .temp_x10 = rec->temp_x10, .hum_x10 = rec->hum_x10 };
+        return p;
+    }
+    const series_rollup_t *r = &rollups[tier - 1];
+    return r->buf[(r->head + r->len - r->count + i) % r->len];
+}
+
+// 某一层已存的点数，调用者持有 sample_ring_lock
+static uint32_t series_count(series_tier_t tier)
+{
+    if (tier == SERIES_TIER_RAW) {
+        return sample_ring != NULL ? series_raw_count : 0;
+    }
+    return rollups[tier - 1].buf != NULL ? rollups[tier - 1].count : 0;
+}
+
+int series_tier_info(series_tier_t tier, uint32_t *step, uint32_t *first_ts, uint32_t *last_ts)
+{
+    if (tier >= SERIES_TIER_COUNT) {
+        return 0;
+    }
+    *step = tier == SERIES_TIER_RAW ? SERIES_RAW_STEP : rollups[tier - 1].step;
+    portENTER_CRITICAL(&sample_ring_lock);
+    uint32_t count = series_count(tier);
+    *first_ts = count ? series_at(tier, 0).ts : 0;
+    *last_ts = count ? series_at(tier, count - 1).ts : 0;
+    portEXIT_CRITICAL(&sample_ring_lock);
+    return (int)count;
+}
+
+// 读取某一层时间范围内的点
+int series_read(series_tier_t tier, uint32_t after_ts, uint32_t to_ts, series_point_t *out, int max)
+{
+    if (tier >= SERIES_TIER_COUNT || max <= 0) {
+        return 0;
+    }
+    int n = 0;
+    portENTER_CRITICAL(&sample_ring_lock);
+    uint32_t count = series_count(tier);
+    // 各层按时间有序，二分查找第一个 ts > after_ts 的点
+    uint32_t lo = 0, hi = count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (series_at(tier, mid).ts <= after_ts) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    for (; lo < count && n < max; lo++) {
+        series_point_t p = series_at(tier, lo);
+        if (p.ts > to_ts) {
+            break;
+        }
+        out[n++] = p;
+    }
+    portEXIT_CRITICAL(&sample_ring_lock);
+    return n;
+}
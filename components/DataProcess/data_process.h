@@ -4,6 +4,7 @@
 #include "esp_err.h"
 #include <time.h>
 #include <stdbool.h>
+#include <stdint.h>
 // 初始化 DHT11
 void data_process_init(void);
 
@@ -18,6 +19,58 @@ int get_temperature_dec(void);
 int get_humidity_int(void);
 int get_humidity_dec(void);
 
+// 获取采样序号（每得到一次有效采样加 1）
+uint32_t get_sample_seq(void);
+
+// 数据版本号：今日极值 / 七天历史发生变化时递增
+uint32_t get_today_gen(void);
+uint32_t get_history_gen(void);
+
+// 最近样本环形缓冲（放在 PSRAM），每 2 s 一条，约保存 1 小时，用于断线续传
+#define SAMPLE_RING_LEN 1800
+
+typedef struct {
+    uint32_t seq;       // 采样序号，与 get_sample_seq() 一致
+    uint32_t ts;        // 设备时间（Unix 秒，未对时前为开机后的秒数）
+    int16_t temp_x10;   // 温度，放大 10 倍
+    uint16_t hum_x10;   // 湿度，放大 10 倍
+} sample_record_t;
+
+// 按时间顺序读取序号大于 after_seq 的样本，最多 max 条，返回条数（读取时持有自旋锁，max 宜小，分批读取）
+// oldest_seq 返回缓冲区中最早样本的序号（缓冲区为空时为 0），调用者据此判断缺口是否已被覆盖；max 为 0 时只查询 oldest_seq
+int get_samples_since(uint32_t after_seq, sample_record_t *out, int max, uint32_t *oldest_seq);
+
+// 读取最新的一条样本（序号与设备时间随实时值一起推送，客户端断线重连后凭序号续传），缓冲区为空时返回 false
+bool get_latest_sample(sample_record_t *out);
+
+// 趋势曲线的存储层：原始样本之外，再按固定时间桶取平均得到更长时间范围的序列
+typedef enum {
+    SERIES_TIER_RAW = 0,    // 原始样本（即上面的样本缓冲），2 s 一点，约 1 小时
+    SERIES_TIER_1M,         // 1 分钟均值，保存 24 小时
+    SERIES_TIER_15M,        // 15 分钟均值，保存 7 天
+    SERIES_TIER_COUNT,
+} series_tier_t;
+
+#define SERIES_1M_LEN   1440
+#define SERIES_15M_LEN  672
+
+typedef struct {
+    uint32_t ts;        // 点的时间（Unix 秒）；均值层为时间桶的起点
+    int16_t temp_x10;
+    uint16_t hum_x10;
+} series_point_t;
+
+// 某一层的点间隔（秒）、当前保存的最早 / 最新时间，返回点数（为 0 时时间无效）
+int series_tier_info(series_tier_t tier, uint32_t *step, uint32_t *first_ts, uint32_t *last_ts);
+
+// 按时间顺序读取 after_ts < ts <= to_ts 的点，最多 max 个，返回个数
+// 与 get_samples_since 一样持自旋锁复制，max 宜小，以最后一点的 ts 作为下一批的 after_ts
+int series_read(series_tier_t tier, uint32_t after_ts, uint32_t to_ts, series_point_t *out, int max);
+
+// 采样周期通知回调：每轮采集结束后在采集任务中调用，回调内不要做耗时操作
+typedef void (*data_process_notify_cb_t)(void *arg);
+void data_process_register_notify(data_process_notify_cb_t cb, void *arg);
+
 //每天的数据结构
 typedef struct  
 {
@@ -0,0 +1,95 @@
+#include "metrics.h"
+
+// 分档上界：250 us 起按 4 倍递增到约 1 s
+const uint32_t metrics_hist_bounds_us[METRICS_HIST_BUCKETS - 1] = {
+    250, 1000, 4000, 16000, 64000, 256000, 1024000
+};
+
+metrics_counter_t g_metrics_counters[METRIC_COUNTER_COUNT];
+metrics_hist_t g_metrics_hists[METRIC_HIST_COUNT];
+
+static const struct {
+    const char *name;
+    const char *help;
+} s_counter_info[METRIC_COUNTER_COUNT] = {
+    [METRIC_WS_FRAMES_SENT]    = { "home_ws_frames_sent",      "WebSocket frames sent" },
+    [METRIC_WS_BYTES_SENT]     = { "home_ws_bytes_sent",       "WebSocket payload bytes sent" },
+    [METRIC_WS_SEND_ERRORS]    = { "home_ws_send_errors",      "WebSocket sends that failed and closed the session" },
+    [METRIC_WS_FRAMES_RECV]    = { "home_ws_frames_received",  "WebSocket frames received" },
+    [METRIC_WS_FRAMES_REPLACED] = { "home_ws_frames_replaced", "Queued WebSocket frames superseded by a newer frame before sending" },
+    [METRIC_WS_SLOW_CLOSED]    = { "home_ws_slow_clients_closed", "WebSocket clients closed because their send queue overflowed or stalled" },
+    [METRIC_SSE_EVENTS_SENT]   = { "home_sse_chunks_sent",     "SSE chunks sent" },
+    [METRIC_SENSOR_READ_OK]    = { "home_sensor_reads_ok",     "Successful DHT11 reads" },
+    [METRIC_SENSOR_READ_FAIL]  = { "home_sensor_reads_failed", "Failed DHT11 reads" },
+    [METRIC_SENSOR_FILTERED]   = { "home_sensor_reads_filtered", "DHT11 readings replaced by the outlier filter" },
+    [METRIC_NVS_COMMITS]       = { "home_nvs_commits",         "NVS commits" },
+    [METRIC_NVS_COMMIT_ERRORS] = { "home_nvs_commit_errors",   "NVS commits that failed" },
+    [METRIC_WS_PUSH_ALLOCS]    = { "home_ws_push_allocs",      "Heap allocations during WebSocket/SSE broadcasts (counted with CONFIG_HOME_ALLOC_CHECK)" },
+    [METRIC_HTTP_THROTTLED]    = { "home_http_throttled",      "HTTP requests answered with 429 by the per-client rate limit" },
+    [METRIC_HTTP_CONN_REJECTED] = { "home_http_connections_rejected", "New connections closed by the per-client rate limit" },
+};
+
+static const struct {
+    const char *name;
+    const char *help;
+} s_hist_info[METRIC_HIST_COUNT] = {
+    [METRIC_HIST_SENSOR_READ] = { "home_sensor_read_duration_seconds", "DHT11 read latency including RMT capture and decode" },
+};
+
+uint32_t metrics_counter_value(const metrics_counter_t *c)
+{
+    uint32_t total = 0;
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        total += atomic_load_explicit(&c->per_core[i], memory_order_relaxed);
+    }
+    return total;
+}
+
+uint32_t metrics_hist_read(const metrics_hist_t *h, uint32_t counts[METRICS_HIST_BUCKETS], uint64_t *sum_us)
+{
+    uint32_t total = 0;
+    uint64_t sum = 0;
+    for (int b = 0; b < METRICS_HIST_BUCKETS; b++) {
+        counts[b] = 0;
+        for (int i = 0; i < portNUM_PROCESSORS; i++) {
+            counts[b] += atomic_load_explicit(&h->bucket[i][b], memory_order_relaxed);
+        }
+        total += counts[b];
+    }
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        // 另一个核心可能正在写，序号为奇数或读取前后变化时重读
+        const metrics_sum_t *s = &h->sum[i];
+        uint32_t seq;
+        uint64_t v;
+        do {
+            seq = atomic_load_explicit(&s->seq, memory_order_acquire);
+            v = *(const volatile uint64_t *)&s->us;
+            atomic_thread_fence(memory_order_acquire);
+        } while ((seq & 1) || seq != atomic_load_explicit(&s->seq, memory_order_relaxed));
+        sum += v;
+    }
+    if (sum_us) {
+        *sum_us = sum;
+    }
+    return total;
+}
+
+const char *metrics_counter_name(metric_counter_id_t id)
+{
+    return s_counter_info[id].name;
+}
+
+const char *metrics_counter_help(metric_counter_id_t id)
+{
+    return s_counter_info[id].help;
+}
+
+const char *metrics_hist_name(metric_hist_id_t id)
+{
+    return s_hist_info[id].name;
+}
+
+const char *metrics_hist_help(metric_hist_id_t id)
+{
+    return s_hist_info[id].help;
+}
@@ -0,0 +1,103 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_cpu.h"
+
+// ===== 运行指标 =====
+// 计数器按核心分槽，记录时只对本核心的槽做一次 relaxed 原子加，热路径上几乎没有开销；
+// 读取（导出 /metrics）时再把各核心的槽相加
+
+typedef struct {
+    _Atomic uint32_t per_core[portNUM_PROCESSORS];
+} metrics_counter_t;
+
+// 固定分档的耗时直方图（微秒），最后一档为 +Inf；各档计数不累加，导出时再换算成累计值
+#define METRICS_HIST_BUCKETS 8
+extern const uint32_t metrics_hist_bounds_us[METRICS_HIST_BUCKETS - 1];
+
+// 耗时总和要 64 位（32 位的微秒数累计约 71 分钟就回绕），Xtensa 没有 64 位原子指令，_Atomic uint64_t
+// 会退化成 libatomic 的临界区。改为每核心一个序号：只有本核心在屏蔽中断期间写，写前后各加 1，
+// 读取时序号为偶数且前后一致才算读到完整的值
+typedef struct {
+    _Atomic uint32_t seq;
+    uint64_t us;
+} metrics_sum_t;
+
+typedef struct {
+    _Atomic uint32_t bucket[portNUM_PROCESSORS][METRICS_HIST_BUCKETS];
+    metrics_sum_t sum[portNUM_PROCESSORS];
+} metrics_hist_t;
+
+// 全局计数器
+typedef enum {
+    METRIC_WS_FRAMES_SENT = 0,  // WebSocket 发出的帧
+    METRIC_WS_BYTES_SENT,       // WebSocket 发出的负载字节
+    METRIC_WS_SEND_ERRORS,      // WebSocket 发送失败
+    METRIC_WS_FRAMES_RECV,      // WebSocket 收到的帧
+    METRIC_WS_FRAMES_REPLACED,  // 在发送队列中被更新的同类帧取代而丢弃的帧
+    METRIC_WS_SLOW_CLOSED,      // 发送队列溢出或长时间发不出去而被断开的客户端
+    METRIC_SSE_EVENTS_SENT,     // SSE 发出的数据块
+    METRIC_SENSOR_READ_OK,      // 传感器读取成功
+    METRIC_SENSOR_READ_FAIL,    // 传感器读取失败
+    METRIC_SENSOR_FILTERED,     // 被异常值过滤替换的读数
+    METRIC_NVS_COMMITS,         // NVS 提交次数
+    METRIC_NVS_COMMIT_ERRORS,   // NVS 提交失败
+    METRIC_WS_PUSH_ALLOCS,      // 广播推送期间的堆分配（开启 CONFIG_HOME_ALLOC_CHECK 时统计）
+    METRIC_HTTP_THROTTLED,      // 按来源限流回 429 的请求
+    METRIC_HTTP_CONN_REJECTED,  // 按来源限流直接关闭的新连接
+    METRIC_COUNTER_COUNT,
+} metric_counter_id_t;
+
+// 全局直方图
+typedef enum {
+    METRIC_HIST_SENSOR_READ = 0, // 一次传感器读取（含 RMT 收发与解码）的耗时
+    METRIC_HIST_COUNT,
+} metric_hist_id_t;
+
+extern metrics_counter_t g_metrics_counters[METRIC_COUNTER_COUNT];
+extern metrics_hist_t g_metrics_hists[METRIC_HIST_COUNT];
+
+static inline void metrics_counter_add(metrics_counter_t *c, uint32_t n)
+{
+    atomic_fetch_add_explicit(&c->per_core[esp_cpu_get_core_id()], n, memory_order_relaxed);
+}
+
+static inline void metrics_hist_observe(metrics_hist_t *h, uint32_t us)
+{
+    int b = 0;
+    while (b < METRICS_HIST_BUCKETS - 1 && us > metrics_hist_bounds_us[b]) {
+        b++;
+    }
+    // 屏蔽本核心中断：期间不会被抢占或迁移，本核心的槽只有这里在写
+    UBaseType_t irq = portSET_INTERRUPT_MASK_FROM_ISR();
+    int core = esp_cpu_get_core_id();
+    atomic_fetch_add_explicit(&h->bucket[core][b], 1, memory_order_relaxed);
+    metrics_sum_t *s = &h->sum[core];
+    uint32_t seq = atomic_load_explicit(&s->seq, memory_order_relaxed);
+    atomic_store_explicit(&s->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    s->us += us;
+    atomic_store_explicit(&s->seq, seq + 2, memory_order_release);
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(irq);
+}
+
+// 全局指标的简写
+#define METRICS_INC(id)         metrics_counter_add(&g_metrics_counters[id], 1)
+#define METRICS_ADD(id, n)      metrics_counter_add(&g_metrics_counters[id], (n))
+#define METRICS_OBSERVE(id, us) metrics_hist_observe(&g_metrics_hists[id], (us))
+
+// 读取：各核心求和
+uint32_t metrics_counter_value(const metrics_counter_t *c);
+// counts 为各档的非累计计数，返回总次数
+uint32_t metrics_hist_read(const metrics_hist_t *h, uint32_t counts[METRICS_HIST_BUCKETS], uint64_t *sum_us);
+
+// 导出用的名称与说明（Prometheus 指标名，不含 _total 等后缀）
+const char *metrics_counter_name(metric_counter_id_t id);
+const char *metrics_counter_help(metric_counter_id_t id);
+const char *metrics_hist_name(metric_hist_id_t id);
+const char *metrics_hist_help(metric_hist_id_t id);
+
+#endif // METRICS_H
@@ -5,6 +5,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
+#include "trace.h"
 
 static const char *TAG = "DHT11_RMT";
 
@@ -70,6 +71,8 @@ esp_err_t dht11_rmt_read(dht11_reading_t *data)
         return ESP_ERR_INVALID_ARG;
     }
 
+    TRACE_BEGIN(TRACE_SENSOR_CAPTURE);
+
     // 清空上次可能遗留的队列数据
     xQueueReset(rx_receive_queue);
 
@@ -99,6 +102,7 @@ esp_err_t dht11_rmt_read(dht11_reading_t *data)
     esp_err_t err = rmt_receive(rx_channel, raw_symbols, sizeof(raw_symbols), &receive_config);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "RMT 启动接收失败: %s", esp_err_to_name(err));
+        TRACE_END(TRACE_SENSOR_CAPTURE);
         return err;
     }
 
@@ -108,8 +112,12 @@ esp_err_t dht11_rmt_read(dht11_reading_t *data)
         ESP_LOGE(TAG, "接收超时");
         rmt_disable(rx_channel);
         rmt_enable(rx_channel);
+        TRACE_END(TRACE_SENSOR_CAPTURE);
         return ESP_ERR_TIMEOUT;
     }
+    TRACE_END(TRACE_SENSOR_CAPTURE);
+
+    TRACE_BEGIN(TRACE_SENSOR_DECODE);
 
     // 使用精准线性波形解析法（消除起始段杂波错位导致的左移翻倍问题）
     int durations[160] = {0};
@@ -156,11 +164,13 @@ esp_err_t dht11_rmt_read(dht11_reading_t *data)
 
     if (bit_index < 40) {
         ESP_LOGE(TAG, "数据解析不完整，仅获取 %d bits (左移错误的根源)", bit_index);
+        TRACE_END(TRACE_SENSOR_DECODE);
         return ESP_ERR_INVALID_SIZE;
     }
 
     // 校验数据
     uint8_t checksum = dht11_bytes[0] + dht11_bytes[1] + dht11_bytes[2] + dht11_bytes[3];
+    TRACE_END(TRACE_SENSOR_DECODE);
     if (checksum != dht11_bytes[4]) {
         ESP_LOGE(TAG, "Checksum failure: calc:%02X != recv:%02X", checksum, dht11_bytes[4]);
         return ESP_FAIL;
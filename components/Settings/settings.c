@@ -0,0 +1,195 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "nvs_flash.h"
+#include "nvs.h"
+#include "settings.h"
+#include "metrics.h"
+#include "trace.h"
+
+static const char *TAG = "SETTINGS";
+
+// 与旧版本保持相同的存储位置和格式，升级后阈值不丢失
+#define SETTINGS_NVS_NAMESPACE  "storage"
+#define SETTINGS_NVS_ALARM_KEY  "alarm_thresh"
+
+// 持续不断的修改也不能无限推迟保存
+#define SETTINGS_SAVE_MAX_DELAY_MS 10000
+
+// 当前生效值：HTTP 任务写，采样/推送等任务在另一个核心读，用原子变量避免读到半个值
+static _Atomic int32_t s_alarm_x10 = SETTINGS_ALARM_DEFAULT_X10;
+
+// 待保存的设置项（按位对应 settings_key_t），队列满时也不会丢失修改
+static _Atomic uint32_t s_dirty = 0;
+
+// 已写入 NVS 的值，只在设置任务中访问，值没变就跳过写入
+static int32_t s_saved_alarm_x10 = SETTINGS_ALARM_DEFAULT_X10;
+
+static QueueHandle_t s_queue = NULL;
+
+// 校验报警阈值并换算为 0.1 ℃ 整数；先按浮点粗筛，避免超大值转换成整数时溢出
+static bool alarm_to_x10(float value, int32_t *x10)
+{
+    if (!isfinite(value) || value < SETTINGS_ALARM_MIN_X10 / 10.0f - 1.0f || value > SETTINGS_ALARM_MAX_X10 / 10.0f + 1.0f) {
+        return false;
+    }
+    *x10 = (int32_t)lroundf(value * 10.0f);
+    return *x10 >= SETTINGS_ALARM_MIN_X10 && *x10 <= SETTINGS_ALARM_MAX_X10;
+}
+
+static void settings_load(void)
+{
+    nvs_handle_t my_handle;
+    if (nvs_open(SETTINGS_NVS_NAMESPACE, NVS_READONLY, &my_handle) != ESP_OK) {
+        return;
+    }
+    char val_str[16];
+    size_t required_size = sizeof(val_str);
+    if (nvs_get_str(my_handle, SETTINGS_NVS_ALARM_KEY, val_str, &required_size) == ESP_OK) {
+        int32_t x10;
+        if (alarm_to_x10(atof(val_str), &x10)) {
+            atomic_store(&s_alarm_x10, x10);
+            s_saved_alarm_x10 = x10;
+            ESP_LOGI(TAG, "从 NVS 加载报警阈值: %.1f", x10 / 10.0f);
+        } else {
+            ESP_LOGW(TAG, "NVS 中的报警阈值无效 (%s)，使用默认值", val_str);
+        }
+    }
+    nvs_close(my_handle);
+}
+
+// 把所有待保存的设置项一次性写入 NVS（只提交一次）；
+// 失败时把待保存标记放回去并返回错误，由设置任务稍后重试
+static esp_err_t settings_flush(void)
+{
+    uint32_t dirty = atomic_exchange(&s_dirty, 0);
+    if (dirty == 0) {
+        return ESP_OK;
+    }
+
+    int32_t alarm_x10 = atomic_load(&s_alarm_x10);
+    if (!(dirty & (1u << SETTINGS_KEY_ALARM_THRESHOLD)) || alarm_x10 == s_saved_alarm_x10) {
+        return ESP_OK;
+    }
+
+    nvs_handle_t my_handle;
+    esp_err_t err = nvs_open(SETTINGS_NVS_NAMESPACE, NVS_READWRITE, &my_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "NVS 打开失败 (%s)，稍后重试", esp_err_to_name(err));
+        atomic_fetch_or(&s_dirty, dirty);
+        return err;
+    }
+    char val_str[16];
+    snprintf(val_str, sizeof(val_str), "%.1f", alarm_x10 / 10.0f);
+    err = nvs_set_str(my_handle, SETTINGS_NVS_ALARM_KEY, val_str);
+    if (err == ESP_OK) {
+        TRACE_BEGIN(TRACE_NVS_COMMIT);
+        err = nvs_commit(my_handle);
+        TRACE_END(TRACE_NVS_COMMIT);
+        METRICS_INC(err == ESP_OK ? METRIC_NVS_COMMITS : METRIC_NVS_COMMIT_ERRORS);
+    }
+    nvs_close(my_handle);
+
+    if (err == ESP_OK) {
+        s_saved_alarm_x10 = alarm_x10;
+        ESP_LOGI(TAG, "已保存报警阈值到 NVS: %s", val_str);
+    } else {
+        ESP_LOGE(TAG, "保存报警阈值失败 (%s)，稍后重试", esp_err_to_name(err));
+        atomic_fetch_or(&s_dirty, dirty);
+    }
+    return err;
+}
+
+// 设置任务：收到修改通知后开始计时，窗口内的后续修改顺延计时（最长不超过上限），到期统一写入；
+// 写入失败时保持待保存状态，重新开始计时，隔一个防抖窗口再试，直到成功
+static void settings_task(void *pvParameters)
+{
+    bool pending = false;
+    TickType_t first_tick = 0;
+    TickType_t last_tick = 0;
+
+    while (1) {
+        TickType_t wait = portMAX_DELAY;
+        if (pending) {
+            TickType_t now = xTaskGetTickCount();
+            TickType_t debounce_end = last_tick + pdMS_TO_TICKS(SETTINGS_SAVE_DEBOUNCE_MS);
+            TickType_t max_end = first_tick + pdMS_TO_TICKS(SETTINGS_SAVE_MAX_DELAY_MS);
+            TickType_t deadline = (int32_t)(max_end - debounce_end) < 0 ? max_end : debounce_end;
+            wait = (int32_t)(deadline - now) > 0 ? deadline - now : 0;
+        }
+
+        settings_key_t key;
+        if (xQueueReceive(s_queue, &key, wait) == pdTRUE) {
+            last_tick = xTaskGetTickCount();
+            if (!pending) {
+                first_tick = last_tick;
+                pending = true;
+            }
+            continue;
+        }
+
+        if (pending) {
+            if (settings_flush() == ESP_OK) {
+                pending = false;
+            } else {
+                // 仍保持待保存，重新计时，一个防抖窗口后重试
+                first_tick = last_tick = xTaskGetTickCount();
+            }
+        }
+    }
+}
+
+esp_err_t settings_init(void)
+{
+    if (s_queue != NULL) {
+        return ESP_OK;
+    }
+    settings_load();
+
+    s_queue = xQueueCreate(SETTINGS_QUEUE_LEN, sizeof(settings_key_t));
+    if (s_queue == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreate(settings_task, "settings_task", 3072, NULL, 3, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "创建设置任务失败");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+// 标记设置项待保存并唤醒设置任务
+static void settings_mark_dirty(settings_key_t key)
+{
+    atomic_fetch_or(&s_dirty, 1u << key);
+    // 队列满说明任务已有待处理的通知，修改已记在 s_dirty 中，不会丢
+    if (s_queue != NULL) {
+        xQueueSend(s_queue, &key, 0);
+    }
+}
+
+esp_err_t settings_set_alarm_threshold(float value)
+{
+    int32_t x10;
+    if (!alarm_to_x10(value, &x10)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (atomic_exchange(&s_alarm_x10, x10) != x10) {
+        settings_mark_dirty(SETTINGS_KEY_ALARM_THRESHOLD);
+    }
+    return ESP_OK;
+}
+
+float settings_get_alarm_threshold(void)
+{
+    return atomic_load(&s_alarm_x10) / 10.0f;
+}
+
+int32_t settings_get_alarm_x10(void)
+{
+    return atomic_load(&s_alarm_x10);
+}
@@ -0,0 +1,37 @@
+#ifndef SETTINGS_H
+#define SETTINGS_H
+
+#include "esp_err.h"
+#include <stdint.h>
+
+// ===== 设置服务 =====
+// 所有可修改的设置由一个常驻任务统一持久化：
+// 内存中的值立即原子更新（任意核心可直接读取），NVS 写入经队列合并后在防抖窗口结束时进行
+
+// 报警阈值（单位 0.1 ℃），超出范围的值会被拒绝
+#define SETTINGS_ALARM_DEFAULT_X10  300
+#define SETTINGS_ALARM_MIN_X10      (-200)
+#define SETTINGS_ALARM_MAX_X10      800
+
+// 最后一次修改后等待多久再写 NVS，窗口内的重复修改只写一次
+#define SETTINGS_SAVE_DEBOUNCE_MS   2000
+#define SETTINGS_QUEUE_LEN          8
+
+// 设置项编号，队列消息中只携带编号，写入时取最新值
+typedef enum {
+    SETTINGS_KEY_ALARM_THRESHOLD = 0,
+    SETTINGS_KEY_COUNT,
+} settings_key_t;
+
+// 从 NVS 加载设置并启动设置任务，须在 Web 服务器启动前调用
+esp_err_t settings_init(void);
+
+// 修改报警阈值：校验后立即生效，稍后异步保存
+// 返回 ESP_ERR_INVALID_ARG 表示数值无效（非数字或超出范围）
+esp_err_t settings_set_alarm_threshold(float value);
+
+// 读取报警阈值，可在任意任务 / 核心调用
+float settings_get_alarm_threshold(void);
+int32_t settings_get_alarm_x10(void);
+
+#endif // SETTINGS_H
@@ -0,0 +1,98 @@
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+#include "esp_rom_sys.h"
+#include "trace.h"
+
+static const char *s_span_names[TRACE_SPAN_COUNT] = {
+    [TRACE_SENSOR_CAPTURE] = "sensor_capture",
+    [TRACE_SENSOR_DECODE]  = "sensor_decode",
+    [TRACE_FILTER]         = "filter",
+    [TRACE_ROLLUP]         = "rollup",
+    [TRACE_JSON_BUILD]     = "json_build",
+    [TRACE_WS_BROADCAST]   = "ws_broadcast",
+    [TRACE_WS_SEND]        = "ws_send",
+    [TRACE_NVS_COMMIT]     = "nvs_commit",
+};
+
+const char *trace_span_name(trace_span_id_t id)
+{
+    return id < TRACE_SPAN_COUNT ? s_span_names[id] : "unknown";
+}
+
+#if CONFIG_HOME_TRACE_ENABLE
+
+// 单个区间：时长用周期数保证精度；结束时刻取 esp_timer（两个核心共用同一时基），用于在时间轴上定位
+typedef struct {
+    uint32_t end_us;        // esp_timer 低 32 位
+    uint32_t dur_cycles;
+    uint8_t id;
+} trace_event_t;
+
+// 每个核心一个环：写入位置用原子自增占位，同核心上被抢占的任务也不会写到同一格
+typedef struct {
+    _Atomic uint32_t head;
+    trace_event_t events[TRACE_RING_LEN];
+} trace_ring_t;
+
+static trace_ring_t s_rings[portNUM_PROCESSORS];
+static _Atomic uint32_t s_migrated;
+
+void trace_record(trace_span_id_t id, int start_core, uint32_t start_cycles, uint32_t end_cycles)
+{
+    int core = esp_cpu_get_core_id();
+    if (core != start_core) {
+        atomic_fetch_add_explicit(&s_migrated, 1, memory_order_relaxed);
+        return;
+    }
+    trace_ring_t *ring = &s_rings[core];
+    uint32_t slot = atomic_fetch_add_explicit(&ring->head, 1, memory_order_relaxed) % TRACE_RING_LEN;
+    trace_event_t *ev = &ring->events[slot];
+    ev->end_us = (uint32_t)esp_timer_get_time();
+    ev->dur_cycles = end_cycles - start_cycles;
+    ev->id = (uint8_t)id;
+}
+
+int trace_foreach(trace_visit_fn_t fn, void *arg)
+{
+    int64_t now = esp_timer_get_time();
+    uint32_t cycles_per_us = esp_rom_get_cpu_ticks_per_us();
+    int total = 0;
+
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        trace_ring_t *ring = &s_rings[core];
+        uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+        uint32_t count = head < TRACE_RING_LEN ? head : TRACE_RING_LEN;
+        for (uint32_t i = head - count; i != head; i++) {
+            // 导出期间仍可能有新区间写入，复制一份再用；偶尔读到被覆盖的格子对诊断无害
+            trace_event_t ev = ring->events[i % TRACE_RING_LEN];
+            if (ev.id >= TRACE_SPAN_COUNT) {
+                continue;
+            }
+            uint32_t dur_us = ev.dur_cycles / cycles_per_us;
+            int64_t end_us = now - (uint32_t)((uint32_t)now - ev.end_us);
+            fn(arg, (trace_span_id_t)ev.id, core, end_us - dur_us, dur_us);
+            total++;
+        }
+    }
+    return total;
+}
+
+uint32_t trace_migrated_count(void)
+{
+    return atomic_load_explicit(&s_migrated, memory_order_relaxed);
+}
+
+#else
+
+int trace_foreach(trace_visit_fn_t fn, void *arg)
+{
+    return 0;
+}
+
+uint32_t trace_migrated_count(void)
+{
+    return 0;
+}
+
+#endif // CONFIG_HOME_TRACE_ENABLE
@@ -0,0 +1,56 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include "sdkconfig.h"
+
+// ===== 轻量级耗时区间追踪 =====
+// TRACE_BEGIN / TRACE_END 成对使用，记录一段代码的耗时（CPU 周期计数），
+// 写入当前核心的无锁环形缓冲。周期计数器每个核心各一个，未绑定核心的任务在区间内被迁移到另一个核心时
+// 两次读数不可比，这样的区间直接丢弃，只计数，由 /diag/trace 导出为 Chrome trace_event JSON，可在 Perfetto 中查看
+// 未开启 CONFIG_HOME_TRACE_ENABLE 时宏展开为空，没有任何开销
+
+// 区间编号，名称见 trace_span_name()
+typedef enum {
+    TRACE_SENSOR_CAPTURE = 0,   // DHT11 起始信号 + RMT 接收
+    TRACE_SENSOR_DECODE,        // 波形解析与校验
+    TRACE_FILTER,               // 异常值过滤
+    TRACE_ROLLUP,               // 今日极值更新与跨天结算
+    TRACE_JSON_BUILD,           // 数据 JSON 生成
+    TRACE_WS_BROADCAST,         // 一轮 WebSocket / SSE 广播
+    TRACE_WS_SEND,              // 单帧 WebSocket 发送
+    TRACE_NVS_COMMIT,           // NVS 提交
+    TRACE_SPAN_COUNT,
+} trace_span_id_t;
+
+#if CONFIG_HOME_TRACE_ENABLE
+
+#include "esp_cpu.h"
+
+#define TRACE_RING_LEN CONFIG_HOME_TRACE_RING_LEN
+
+// 记录一个已结束的区间（一般通过 TRACE_END 调用）
+// start_core 为开始时所在的核心，与结束时不同则丢弃
+void trace_record(trace_span_id_t id, int start_core, uint32_t start_cycles, uint32_t end_cycles);
+
+#define TRACE_BEGIN(id) int _trace_core_##id = esp_cpu_get_core_id(); \
+                        uint32_t _trace_start_##id = esp_cpu_get_cycle_count()
+#define TRACE_END(id)   trace_record((id), _trace_core_##id, _trace_start_##id, esp_cpu_get_cycle_count())
+
+#else
+
+#define TRACE_BEGIN(id) do { } while (0)
+#define TRACE_END(id)   do { } while (0)
+
+#endif // CONFIG_HOME_TRACE_ENABLE
+
+const char *trace_span_name(trace_span_id_t id);
+
+// 导出时遍历：按核心依次回调每个区间（开始时间与时长均为微秒），返回区间总数
+typedef void (*trace_visit_fn_t)(void *arg, trace_span_id_t id, int core, int64_t start_us, uint32_t dur_us);
+int trace_foreach(trace_visit_fn_t fn, void *arg);
+
+// 因跨核心迁移而丢弃的区间数
+uint32_t trace_migrated_count(void);
+
+#endif // TRACE_H
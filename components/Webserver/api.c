@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "data_process.h"
+#include "settings.h"
+#include "data_json.h"
+#include "http_cache.h"
+#include "api.h"
+
+// 所有数据都要求浏览器每次校验，命中时只回一个 304
+#define API_CACHE_CONTROL "no-cache"
+
+// 输出缓冲：整个响应装得下时一次发出（带 Content-Length），装不下时按 chunk 流式发送，
+// 放在栈上，history 在异步工作线程中并发执行也互不干扰
+#define API_OUT_BUF_SIZE 512
+
+// 按字段组生成 JSON 对象并发送，with_seq 为 true 时附带采样序号
+static esp_err_t api_send_fields(httpd_req_t *req, uint32_t fields, bool with_seq, uint32_t seq)
+{
+    char buf[API_OUT_BUF_SIZE];
+    json_writer_t w;
+    json_writer_init_http(&w, req, buf, sizeof(buf));
+
+    httpd_resp_set_type(req, "application/json");
+    json_obj_begin(&w);
+    data_json_fields(&w, fields);
+    if (with_seq) {
+        // 采样序号与启动 ID，拼成续传令牌后可向 /api/recent?after= 补取错过的样本
+        char boot[9];
+        data_json_boot_str(boot, sizeof(boot));
+        json_kv_uint(&w, "seq", seq);
+        json_kv_str(&w, "boot", boot);
+    }
+    json_obj_end(&w);
+    return json_writer_send(&w);
+}
+
+esp_err_t api_live_handler(httpd_req_t *req)
+{
+    uint32_t seq = get_sample_seq();
+    char etag[HTTP_ETAG_LEN];
+    http_cache_make_etag(etag, sizeof(etag), "l", seq);
+    if (http_cache_check(req, etag, API_CACHE_CONTROL)) {
+        return ESP_OK;
+    }
+
+    return api_send_fields(req, DATA_JSON_LIVE, true, seq);
+}
+
+esp_err_t api_today_handler(httpd_req_t *req)
+{
+    // 报警阈值也放在这里，ETag 由极值版本和阈值共同决定
+    char prefix[16];
+    snprintf(prefix, sizeof(prefix), "t%lu-a", (unsigned long)get_today_gen());
+    char etag[HTTP_ETAG_LEN];
+    http_cache_make_etag(etag, sizeof(etag), prefix, (uint32_t)settings_get_alarm_x10());
+    if (http_cache_check(req, etag, API_CACHE_CONTROL)) {
+        return ESP_OK;
+    }
+    return api_send_fields(req, DATA_JSON_TODAY | DATA_JSON_ALARM, false, 0);
+}
+
+esp_err_t api_history_handler(httpd_req_t *req)
+{
+    char etag[HTTP_ETAG_LEN];
+    http_cache_make_etag(etag, sizeof(etag), "h", get_history_gen());
+    if (http_cache_check(req, etag, API_CACHE_CONTROL)) {
+        return ESP_OK;
+    }
+    return api_send_fields(req, DATA_JSON_HISTORY, false, 0);
+}
+
+esp_err_t api_recent_handler(httpd_req_t *req)
+{
+    int n = DATA_JSON_RECENT_DEFAULT;
+    bool has_after = false;
+    char after[DATA_JSON_TOKEN_LEN];
+    char query[64];
+    char val[12];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        if (httpd_query_key_value(query, "n", val, sizeof(val)) == ESP_OK) {
+            n = atoi(val);
+        }
+        // after=<续传令牌>：HTTP 轮询保底时补取该样本之后错过的样本
+        has_after = httpd_query_key_value(query, "after", after, sizeof(after)) == ESP_OK;
+    }
+    if (n <= 0 || n > SAMPLE_RING_LEN) {
+        n = DATA_JSON_RECENT_DEFAULT;
+    }
+
+    char buf[API_OUT_BUF_SIZE];
+    json_writer_t w;
+    json_writer_init_http(&w, req, buf, sizeof(buf));
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", API_CACHE_CONTROL);
+    json_obj_begin(&w);
+    if (has_after) {
+        bool gap = data_json_since(&w, after, SAMPLE_RING_LEN) < 0;
+        json_kv_str(&w, "status", gap ? "gap" : "ok");
+        data_json_cursor(&w);
+    } else {
+        data_json_recent(&w, n);
+    }
+    json_obj_end(&w);
+    return json_writer_send(&w);
+}
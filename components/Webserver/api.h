@@ -0,0 +1,27 @@
+#ifndef API_H
+#define API_H
+
+#include "esp_http_server.h"
+
+// 拆分后的数据接口，按各自的版本号生成 ETag，支持 If-None-Match 条件请求
+// GET /api/live    实时温湿度（每次采样变化）
+// GET /api/today   今日极值与报警阈值（极值变化或阈值修改时变化）
+// GET /api/history 七天历史（每天跨天时变化一次）
+esp_err_t api_live_handler(httpd_req_t *req);
+esp_err_t api_today_handler(httpd_req_t *req);
+esp_err_t api_history_handler(httpd_req_t *req);
+
+// GET /api/recent?n=150 最近 n 个原始样本（最多为样本缓冲长度），紧凑格式见 data_json_recent
+esp_err_t api_recent_handler(httpd_req_t *req);
+
+// GET /api/series?from=&to=&n=&fields=temp,hum
+// 从原始样本或 1 分钟 / 15 分钟均值层中取出时间范围内的点，用 LTTB 降采样到最多 n 个，
+// 返回 {"tier","step","from","to","count","temp":[[ts,值],...],"hum":[...]}
+esp_err_t api_series_handler(httpd_req_t *req);
+
+// GET /spark.svg?metric=temp|hum&range=1h|24h|7d&w=&h=&label=1
+// 在设备上把对应层的曲线画成一条 SVG 折线（每像素列最多一个点），不需要 chart.js；
+// ETag 由所用的层和该层最新时间桶决定，label=1 时在右上角标出最新值
+esp_err_t api_spark_handler(httpd_req_t *req);
+
+#endif // API_H
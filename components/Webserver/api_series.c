@@ -0,0 +1,417 @@
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "esp_heap_caps.h"
+#include "data_process.h"
+#include "json_writer.h"
+#include "http_cache.h"
+#include "api.h"
+
+// 返回点数：默认值与上限（上限约为手机横屏的像素宽度，再多 chart.js 也画不出区别）
+#define SERIES_DEFAULT_POINTS   200
+#define SERIES_MAX_POINTS       500
+// 未指定 from 时默认查询最近 1 小时
+#define SERIES_DEFAULT_RANGE    3600
+// 每次持锁复制的点数
+#define SERIES_READ_BATCH       64
+#define SERIES_OUT_BUF_SIZE     512
+
+// 迷你曲线图：默认与最大尺寸（像素），每个像素列最多一个点
+#define SPARK_DEFAULT_W         240
+#define SPARK_DEFAULT_H         48
+#define SPARK_MIN_SIZE          16
+#define SPARK_MAX_W             SERIES_MAX_POINTS
+#define SPARK_MAX_H             300
+// 线条上下留出的边距（0.1 像素）
+#define SPARK_PAD_X10           20
+
+static const char *const s_tier_names[SERIES_TIER_COUNT] = { "raw", "1m", "15m" };
+
+// 各层最多保存的点数，决定读取缓冲的大小
+static const uint32_t s_tier_len[SERIES_TIER_COUNT] = { SAMPLE_RING_LEN, SERIES_1M_LEN, SERIES_15M_LEN };
+
+static uint32_t query_u32(const char *query, const char *key, uint32_t def)
+{
+    char val[16];
+    if (query == NULL || httpd_query_key_value(query, key, val, sizeof(val)) != ESP_OK) {
+        return def;
+    }
+    char *end;
+    unsigned long v = strtoul(val, &end, 10);
+    return (end != val && *end == '\0') ? (uint32_t)v : def;
+}
+
+// 选层：取能覆盖 from 的最细一层。各层都还没积累到 from 时（刚开机），
+// 以所有层中最早的数据为起点比较；较粗的层只早不到一个自己的时间桶时仍选较细的层
+static series_tier_t series_pick_tier(uint32_t from)
+{
+    uint32_t step[SERIES_TIER_COUNT], first[SERIES_TIER_COUNT], last;
+    int count[SERIES_TIER_COUNT];
+    uint32_t earliest = UINT32_MAX;
+    for (int t = 0; t < SERIES_TIER_COUNT; t++) {
+        count[t] = series_tier_info((series_tier_t)t, &step[t], &first[t], &last);
+        if (count[t] > 0 && first[t] < earliest) {
+            earliest = first[t];
+        }
+    }
+    uint32_t start = from > earliest ? from : earliest;
+    for (int t = 0; t < SERIES_TIER_COUNT; t++) {
+        uint32_t slack = t + 1 < SERIES_TIER_COUNT ? step[t + 1] : 0;
+        if (count[t] > 0 && first[t] <= start + slack) {
+            return (series_tier_t)t;
+        }
+    }
+    return SERIES_TIER_COUNT - 1;
+}
+
+static inline int32_t series_value(const series_point_t *p, bool hum)
+{
+    return hum ? (int32_t)p->hum_x10 : (int32_t)p->temp_x10;
+}
+
+// Largest-Triangle-Three-Buckets：首尾两点固定，其余点均分为 n_out - 2 个桶，
+// 每个桶里选出与「上一个选中点」和「下一个桶的平均点」构成三角形面积最大的点，
+// 峰谷等形状特征得以保留。选中的下标写入 idx，返回个数；点数不多于 n_out 时全部保留
+static int lttb_select(const series_point_t *pts, int count, int n_out, bool hum, uint16_t *idx)
+{
+    if (count <= n_out) {
+        for (int i = 0; i < count; i++) {
+            idx[i] = (uint16_t)i;
+        }
+        return count;
+    }
+
+    // 时间取相对第一个点的秒数，float 足够表示 7 天范围
+    const uint32_t t0 = pts[0].ts;
+    const float every = (float)(count - 2) / (float)(n_out - 2);
+    int k = 0;
+    int a = 0;
+    idx[k++] = 0;
+    for (int i = 0; i < n_out - 2; i++) {
+        int avg_start = (int)((i + 1) * every) + 1;
+        int avg_end = (int)((i + 2) * every) + 1;
+        if (avg_end > count) {
+            avg_end = count;
+        }
+        float avg_x = 0, avg_y = 0;
+        for (int j = avg_start; j < avg_end; j++) {
+            avg_x += (float)(pts[j].ts - t0);
+            avg_y += (float)series_value(&pts[j], hum);
+        }
+        int avg_len = avg_end - avg_start;
+        if (avg_len > 0) {
+            avg_x /= (float)avg_len;
+            avg_y /= (float)avg_len;
+        }
+
+        int start = (int)(i * every) + 1;
+        int end = (int)((i + 1) * every) + 1;
+        float ax = (float)(pts[a].ts - t0);
+        float ay = (float)series_value(&pts[a], hum);
+        float max_area = -1.0f;
+        int next = start;
+        for (int j = start; j < end; j++) {
+            float area = fabsf((ax - avg_x) * ((float)series_value(&pts[j], hum) - ay) -
+                               (ax - (float)(pts[j].ts - t0)) * (avg_y - ay));
+            if (area > max_area) {
+                max_area = area;
+                next = j;
+            }
+        }
+        idx[k++] = (uint16_t)next;
+        a = next;
+    }
+    idx[k++] = (uint16_t)(count - 1);
+    return k;
+}
+
+// 把 tier 层中 from <= ts <= to 的点整段复制出来，另附 LTTB 用的下标缓冲，用 free 一起释放；
+// 最多约 14 KB，放 PSRAM。调用方都走异步工作线程，不在稳态路径上，每次请求一次分配可以接受
+static series_point_t *series_load(series_tier_t tier, uint32_t from, uint32_t to, int *count, uint16_t **idx)
+{
+    uint32_t cap = s_tier_len[tier];
+    size_t bytes = cap * sizeof(series_point_t) + SERIES_MAX_POINTS * sizeof(uint16_t);
+    series_point_t *pts = heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM);
+    if (pts == NULL) {
+        pts = heap_caps_malloc(bytes, MALLOC_CAP_DEFAULT);
+    }
+    if (pts == NULL) {
+        return NULL;
+    }
+    *idx = (uint16_t *)(pts + cap);
+
+    int n_total = 0;
+    uint32_t after = from > 0 ? from - 1 : 0;
+    while ((uint32_t)n_total < cap) {
+        int want = cap - n_total < SERIES_READ_BATCH ? (int)(cap - n_total) : SERIES_READ_BATCH;
+        int n = series_read(tier, after, to, pts + n_total, want);
+        n_total += n;
+        if (n < want) {
+            break;
+        }
+        after = pts[n_total - 1].ts;
+    }
+    *count = n_total;
+    return pts;
+}
+
+// 输出一条序列：[[ts, 值], ...]
+static void series_write(json_writer_t *w, const char *key, const series_point_t *pts, int count,
+                         int n_out, bool hum, uint16_t *idx)
+{
+    int n = lttb_select(pts, count, n_out, hum, idx);
+    json_key(w, key);
+    json_arr_begin(w);
+    for (int i = 0; i < n; i++) {
+        const series_point_t *p = &pts[idx[i]];
+        json_arr_begin(w);
+        json_uint(w, p->ts);
+        json_fixed(w, series_value(p, hum), 1);
+        json_arr_end(w);
+    }
+    json_arr_end(w);
+}
+
+esp_err_t api_series_handler(httpd_req_t *req)
+{
+    char query[96];
+    bool has_query = httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK;
+    const char *q = has_query ? query : NULL;
+
+    uint32_t now = (uint32_t)time(NULL);
+    uint32_t to = query_u32(q, "to", now);
+    uint32_t from = query_u32(q, "from", to > SERIES_DEFAULT_RANGE ? to - SERIES_DEFAULT_RANGE : 0);
+    uint32_t n_out = query_u32(q, "n", SERIES_DEFAULT_POINTS);
+    if (n_out < 3) {
+        n_out = 3;
+    } else if (n_out > SERIES_MAX_POINTS) {
+        n_out = SERIES_MAX_POINTS;
+    }
+    if (from > to) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "from > to");
+        return ESP_OK;
+    }
+
+    // fields=temp,hum，缺省两条都返回
+    bool want_temp = true, want_hum = true;
+    char fields[16];
+    if (q != NULL && httpd_query_key_value(q, "fields", fields, sizeof(fields)) == ESP_OK) {
+        want_temp = strstr(fields, "temp") != NULL;
+        want_hum = strstr(fields, "hum") != NULL;
+    }
+
+    series_tier_t tier = series_pick_tier(from);
+    uint32_t step, first_ts, last_ts;
+    series_tier_info(tier, &step, &first_ts, &last_ts);
+
+    int count;
+    uint16_t *idx;
+    series_point_t *pts = series_load(tier, from, to, &count, &idx);
+    if (pts == NULL) {
+        httpd_resp_send_500(req);
+        return ESP_ERR_NO_MEM;
+    }
+
+    char buf[SERIES_OUT_BUF_SIZE];
+    json_writer_t w;
+    json_writer_init_http(&w, req, buf, sizeof(buf));
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    json_obj_begin(&w);
+    json_kv_str(&w, "tier", s_tier_names[tier]);
+    json_kv_uint(&w, "step", step);
+    json_kv_uint(&w, "from", from);
+    json_kv_uint(&w, "to", to);
+    json_kv_int(&w, "count", count);
+    if (want_temp) {
+        series_write(&w, "temp", pts, count, (int)n_out, false, idx);
+    }
+    if (want_hum) {
+        series_write(&w, "hum", pts, count, (int)n_out, true, idx);
+    }
+    json_obj_end(&w);
+    esp_err_t err = json_writer_send(&w);
+
+    free(pts);
+    return err;
+}
+
+// 迷你曲线图的时间范围
+typedef struct {
+    const char *name;
+    uint32_t seconds;
+} spark_range_t;
+
+static const spark_range_t s_spark_ranges[] = {
+    { "1h",  3600 },
+    { "24h", 86400 },
+    { "7d",  7 * 86400 },
+};
+
+// SVG 文本输出：攒满缓冲就作为一个 chunk 发出，整个图装得下时一次发送（带 Content-Length）。
+// 在异步工作线程中可能并发执行，缓冲放在调用者栈上
+typedef struct {
+    httpd_req_t *req;
+    char buf[SERIES_OUT_BUF_SIZE];
+    int len;
+    bool chunked;
+} spark_out_t;
+
+static void spark_flush(spark_out_t *o)
+{
+    if (o->len > 0) {
+        httpd_resp_send_chunk(o->req, o->buf, o->len);
+        o->len = 0;
+        o->chunked = true;
+    }
+}
+
+static void spark_printf(spark_out_t *o, const char *fmt, ...)
+{
+    for (int attempt = 0; attempt < 2; attempt++) {
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(o->buf + o->len, sizeof(o->buf) - o->len, fmt, ap);
+        va_end(ap);
+        if (n >= 0 && n < (int)sizeof(o->buf) - o->len) {
+            o->len += n;
+            return;
+        }
+        spark_flush(o);
+    }
+}
+
+static esp_err_t spark_finish(spark_out_t *o)
+{
+    if (!o->chunked) {
+        return httpd_resp_send(o->req, o->buf, o->len);
+    }
+    spark_flush(o);
+    return httpd_resp_send_chunk(o->req, NULL, 0);
+}
+
+// 坐标统一用 0.1 像素的整数表示，输出一位小数，不经过 newlib 的 %f
+static void spark_coord(spark_out_t *o, const char *sep, int32_t x10, int32_t y10)
+{
+    spark_printf(o, "%s%ld.%ld,%ld.%ld", sep, (long)(x10 / 10), (long)(x10 % 10),
+                 (long)(y10 / 10), (long)(y10 % 10));
+}
+
+esp_err_t api_spark_handler(httpd_req_t *req)
+{
+    char query[96];
+    bool has_query = httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK;
+    const char *q = has_query ? query : NULL;
+
+    // metric=temp|hum，缺省为温度
+    bool hum = false;
+    char val[8];
+    if (q != NULL && httpd_query_key_value(q, "metric", val, sizeof(val)) == ESP_OK) {
+        if (strcmp(val, "hum") == 0) {
+            hum = true;
+        } else if (strcmp(val, "temp") != 0) {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "metric must be temp or hum");
+            return ESP_OK;
+        }
+    }
+
+    // range=1h|24h|7d，缺省为 24 小时
+    const spark_range_t *range = &s_spark_ranges[1];
+    if (q != NULL && httpd_query_key_value(q, "range", val, sizeof(val)) == ESP_OK) {
+        range = NULL;
+        for (size_t i = 0; i < sizeof(s_spark_ranges) / sizeof(s_spark_ranges[0]); i++) {
+            if (strcmp(val, s_spark_ranges[i].name) == 0) {
+                range = &s_spark_ranges[i];
+                break;
+            }
+        }
+        if (range == NULL) {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "range must be 1h, 24h or 7d");
+            return ESP_OK;
+        }
+    }
+
+    uint32_t w = query_u32(q, "w", SPARK_DEFAULT_W);
+    uint32_t h = query_u32(q, "h", SPARK_DEFAULT_H);
+    w = w < SPARK_MIN_SIZE ? SPARK_MIN_SIZE : (w > SPARK_MAX_W ? SPARK_MAX_W : w);
+    h = h < SPARK_MIN_SIZE ? SPARK_MIN_SIZE : (h > SPARK_MAX_H ? SPARK_MAX_H : h);
+    bool label = query_u32(q, "label", 0) != 0;
+
+    // 选层与 /api/series 相同；时间窗以该层最新的点为终点，图像只取决于层和最新时间桶，
+    // 同一个桶内的请求得到同一个 ETag（参数不同则 URL 不同，浏览器分开缓存）
+    uint32_t now = (uint32_t)time(NULL);
+    series_tier_t tier = series_pick_tier(now > range->seconds ? now - range->seconds : 0);
+    uint32_t step, first_ts, last_ts;
+    int available = series_tier_info(tier, &step, &first_ts, &last_ts);
+    if (available == 0) {
+        last_ts = 0;
+    }
+
+    char prefix[8];
+    snprintf(prefix, sizeof(prefix), "s%d-", (int)tier);
+    char etag[HTTP_ETAG_LEN];
+    http_cache_make_etag(etag, sizeof(etag), prefix, last_ts);
+    httpd_resp_set_type(req, "image/svg+xml");
+    if (http_cache_check(req, etag, "no-cache")) {
+        return ESP_OK;
+    }
+
+    uint32_t from = last_ts > range->seconds ? last_ts - range->seconds : 0;
+    int count = 0;
+    uint16_t *idx = NULL;
+    series_point_t *pts = NULL;
+    if (available > 0) {
+        pts = series_load(tier, from, last_ts, &count, &idx);
+        if (pts == NULL) {
+            httpd_resp_send_500(req);
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    spark_out_t o = { .req = req };
+    const char *color = hum ? "#36a2eb" : "#ff6384";
+    spark_printf(&o, "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"%lu\" height=\"%lu\" "
+                 "viewBox=\"0 0 %lu %lu\">", (unsigned long)w, (unsigned long)h, (unsigned long)w, (unsigned long)h);
+
+    // 每个像素列最多一个点，LTTB 保留峰谷
+    int n = lttb_select(pts, count, (int)w, hum, idx);
+    if (n > 0) {
+        int32_t lo = INT32_MAX, hi = INT32_MIN;
+        for (int i = 0; i < n; i++) {
+            int32_t v = series_value(&pts[idx[i]], hum);
+            lo = v < lo ? v : lo;
+            hi = v > hi ? v : hi;
+        }
+        // x 按时间定位（刚开机数据不满一个范围时曲线从中间开始），y 按范围内的最低 / 最高值拉伸，平线居中
+        int64_t span_x10 = (int64_t)w * 10;
+        int64_t span_y10 = (int64_t)h * 10 - 2 * SPARK_PAD_X10;
+        spark_printf(&o, "<polyline fill=\"none\" stroke=\"%s\" stroke-width=\"1.5\" "
+                     "stroke-linejoin=\"round\" points=\"", color);
+        for (int i = 0; i < n; i++) {
+            const series_point_t *p = &pts[idx[i]];
+            int32_t x10 = (int32_t)((int64_t)(p->ts - from) * span_x10 / range->seconds);
+            int32_t y10 = hi == lo ? (int32_t)(h * 5) :
+                          SPARK_PAD_X10 + (int32_t)((int64_t)(hi - series_value(p, hum)) * span_y10 / (hi - lo));
+            spark_coord(&o, i == 0 ? "" : " ", x10, y10);
+        }
+        spark_printf(&o, "\"/>");
+
+        // label=1：右上角标出最新值（无 JS 的页面用它代替数字面板）
+        if (label) {
+            int32_t last = series_value(&pts[count - 1], hum);
+            int32_t mag = last < 0 ? -last : last;
+            spark_printf(&o, "<text x=\"%lu\" y=\"12\" text-anchor=\"end\" font-family=\"sans-serif\" "
+                         "font-size=\"12\" fill=\"%s\">%s%ld.%ld%s</text>",
+                         (unsigned long)(w - 2), color, last < 0 ? "-" : "", (long)(mag / 10), (long)(mag % 10),
+                         hum ? "%" : "°C");
+        }
+    }
+    spark_printf(&o, "</svg>");
+    esp_err_t err = spark_finish(&o);
+
+    free(pts);
+    return err;
+}
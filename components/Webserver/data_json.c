@@ -0,0 +1,261 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "esp_netif.h"
+#include "data_process.h"
+#include "ap.h"
+#include "settings.h"
+#include "data_json.h"
+#include "http_cache.h"
+#include "web.h"
+#include "trace.h"
+
+// 实时温度 / 湿度换算为 0.1 单位的定点数（整数部分为负时小数部分同号）
+static int32_t live_x10(int int_part, int dec_part)
+{
+    return int_part < 0 ? int_part * 10 - dec_part : int_part * 10 + dec_part;
+}
+
+void data_json_fields(json_writer_t *w, uint32_t fields)
+{
+    TRACE_BEGIN(TRACE_JSON_BUILD);
+
+    if (fields & DATA_JSON_LIVE) {
+        // 获取实时温湿度数据
+        json_kv_fixed_str(w, "temperature", live_x10(get_temperature_int(), get_temperature_dec()), 1);
+        json_kv_fixed_str(w, "humidity", live_x10(get_humidity_int(), get_humidity_dec()), 1);
+    }
+
+    if (fields & DATA_JSON_SAMPLE) {
+        sample_record_t rec = { 0 };
+        get_latest_sample(&rec);
+        char boot[9];
+        data_json_boot_str(boot, sizeof(boot));
+        json_kv_str(w, "boot", boot);
+        json_kv_uint(w, "sample_seq", rec.seq);
+        json_kv_uint(w, "ts", rec.ts);
+    }
+
+    if (fields & DATA_JSON_TODAY) {
+        // 获取今日统计数据
+        float max_t_today, min_t_today, max_h_today, min_h_today;
+        get_today_stats(&max_t_today, &min_t_today, &max_h_today, &min_h_today);
+        json_kv_fixed_str(w, "max_temp_today", json_float_to_fixed(max_t_today, 1), 1);
+        json_kv_fixed_str(w, "min_temp_today", json_float_to_fixed(min_t_today, 1), 1);
+        json_kv_fixed_str(w, "max_hum_today", json_float_to_fixed(max_h_today, 1), 1);
+        json_kv_fixed_str(w, "min_hum_today", json_float_to_fixed(min_h_today, 1), 1);
+    }
+
+    if (fields & DATA_JSON_ALARM) {
+        json_kv_fixed_str(w, "alarmThreshold", settings_get_alarm_x10(), 1);
+    }
+
+    if (fields & DATA_JSON_HISTORY) {
+        //获取七天历史数据
+        DailyData history[7];
+        get_weekly_history(history);
+
+        json_key(w, "history");
+        json_arr_begin(w);
+        for (int i = 0; i < 7; i++) {
+            // 如果数据无效，就填 null，前端判断是否为空
+            if (!history[i].valid) {
+                json_null(w);
+                continue;
+            }
+            json_obj_begin(w);
+            json_kv_int(w, "day_ago", i + 1);
+            json_kv_int(w, "weekday", history[i].weekday);
+            json_kv_fixed(w, "max_temp", json_float_to_fixed(history[i].max_temp, 1), 1);
+            json_kv_fixed(w, "min_temp", json_float_to_fixed(history[i].min_temp, 1), 1);
+            json_kv_fixed(w, "max_hum", json_float_to_fixed(history[i].max_hum, 1), 1);
+            json_kv_fixed(w, "min_hum", json_float_to_fixed(history[i].min_hum, 1), 1);
+            json_obj_end(w);
+        }
+        json_arr_end(w);
+    }
+
+    TRACE_END(TRACE_JSON_BUILD);
+}
+
+int data_json_write_frame(char *buf, size_t size, bool snapshot, uint32_t seq, uint32_t fields)
+{
+    json_writer_t w;
+    json_writer_init_buf(&w, buf, size);
+    json_obj_begin(&w);
+    json_kv_int(&w, "v", 2);
+    json_kv_str(&w, "type", snapshot ? "snap" : "delta");
+    json_kv_uint(&w, "seq", seq);
+    data_json_fields(&w, fields);
+    json_obj_end(&w);
+    return json_writer_finish(&w);
+}
+
+void data_json_prov(json_writer_t *w, bool ws_frame)
+{
+    wifi_prov_status_t st;
+    wifi_prov_get_status(&st);
+
+    json_obj_begin(w);
+    if (ws_frame) {
+        json_kv_int(w, "v", 2);
+        json_kv_str(w, "type", "prov");
+    }
+    json_kv_uint(w, "job", st.job_id);
+    json_kv_str(w, "state", wifi_prov_state_name(st.state));
+    if (st.state == WIFI_PROV_FAILED) {
+        json_kv_str(w, "reason", wifi_prov_reason_name(st.reason));
+        json_kv_int(w, "code", st.reason);
+    } else if (st.state == WIFI_PROV_GOT_IP) {
+        esp_ip4_addr_t ip = { .addr = st.ip };
+        char ip_str[16];
+        snprintf(ip_str, sizeof(ip_str), IPSTR, IP2STR(&ip));
+        json_kv_str(w, "ip", ip_str);
+    }
+    json_obj_end(w);
+}
+
+int data_json_write_prov(char *buf, size_t size, bool ws_frame)
+{
+    json_writer_t w;
+    json_writer_init_buf(&w, buf, size);
+    data_json_prov(&w, ws_frame);
+    return json_writer_finish(&w);
+}
+
+// 完整数据 JSON：HTTP /data、旧版 WebSocket 帧共用
+int data_json_write_full(char *buf, size_t size)
+{
+    json_writer_t w;
+    json_writer_init_buf(&w, buf, size);
+    json_obj_begin(&w);
+    data_json_fields(&w, DATA_JSON_ALL);
+    json_obj_end(&w);
+    return json_writer_finish(&w);
+}
+
+// 首页注入的初始状态：完整数据 + 最新样本序号 + 设备时钟
+int data_json_write_boot(char *buf, size_t size)
+{
+    json_writer_t w;
+    json_writer_init_buf(&w, buf, size);
+    json_obj_begin(&w);
+    data_json_fields(&w, DATA_JSON_ALL | DATA_JSON_SAMPLE);
+    json_key(&w, "clock");
+    json_obj_begin(&w);
+    json_kv_uint(&w, "ts", (uint32_t)time(NULL));
+    json_kv_bool(&w, "synced", g_is_ntp_synced || time_sync_done);
+    json_kv_str(&w, "source", g_is_ntp_synced ? "ntp" : (time_sync_done ? "web" : "none"));
+    json_obj_end(&w);
+    json_obj_end(&w);
+    return json_writer_finish(&w);
+}
+
+// 每次从样本缓冲复制的条数（持自旋锁复制，宜小）
+#define RECENT_BATCH 32
+
+// 序号 after 之后的 count 个样本，调用者已确认这些样本都还在缓冲里
+static int data_json_samples(json_writer_t *w, uint32_t after, uint32_t count)
+{
+    sample_record_t recs[RECENT_BATCH];
+    uint32_t ts0 = 0;
+    if (count > 0 && get_samples_since(after, recs, 1, NULL) == 1) {
+        ts0 = recs[0].ts;
+    }
+    json_kv_uint(w, "from_seq", count ? after + 1 : 0);
+    json_kv_uint(w, "ts0", ts0);
+
+    static const char *const keys[] = { "dt", "temp", "hum" };
+    for (int k = 0; k < 3; k++) {
+        json_key(w, keys[k]);
+        json_arr_begin(w);
+        uint32_t done = 0;
+        uint32_t prev_ts = ts0;
+        uint32_t cursor = after;
+        while (done < count) {
+            int want = count - done < RECENT_BATCH ? (int)(count - done) : RECENT_BATCH;
+            int got = get_samples_since(cursor, recs, want, NULL);
+            if (got <= 0) {
+                break;
+            }
+            for (int i = 0; i < got; i++) {
+                const sample_record_t *r = &recs[i];
+                if (k == 0) {
+                    json_int(w, (int64_t)r->ts - prev_ts);
+                    prev_ts = r->ts;
+                } else if (k == 1) {
+                    json_fixed(w, r->temp_x10, 1);
+                } else {
+                    json_fixed(w, r->hum_x10, 1);
+                }
+            }
+            cursor = recs[got - 1].seq;
+            done += got;
+        }
+        json_arr_end(w);
+    }
+    return (int)count;
+}
+
+int data_json_recent(json_writer_t *w, int n)
+{
+    // 先确定序号范围，三个数组各读一遍同一段样本
+    uint32_t newest = get_sample_seq();
+    uint32_t oldest;
+    get_samples_since(newest, NULL, 0, &oldest);
+    uint32_t avail = oldest ? newest - oldest + 1 : 0;
+    uint32_t count = n > 0 && (uint32_t)n < avail ? (uint32_t)n : avail;
+    return data_json_samples(w, newest - count, count);
+}
+
+void data_json_boot_str(char *buf, size_t size)
+{
+    snprintf(buf, size, "%08lx", (unsigned long)http_cache_boot_id());
+}
+
+bool data_json_parse_token(const char *token, uint32_t *seq)
+{
+    char boot[9];
+    data_json_boot_str(boot, sizeof(boot));
+    // 启动 ID 不同说明设备重启过（或是旧版本客户端只发了序号），序号已不可比
+    if (token == NULL || strncmp(token, boot, 8) != 0 || token[8] != '-' || token[9] < '0' || token[9] > '9') {
+        return false;
+    }
+    char *end;
+    unsigned long v = strtoul(token + 9, &end, 10);
+    if (end == token + 9 || *end != '\0') {
+        return false;
+    }
+    *seq = (uint32_t)v;
+    return true;
+}
+
+void data_json_cursor(json_writer_t *w)
+{
+    char boot[9];
+    data_json_boot_str(boot, sizeof(boot));
+    json_kv_str(w, "boot", boot);
+    json_kv_uint(w, "sample_seq", get_sample_seq());
+}
+
+int data_json_since(json_writer_t *w, const char *token, int max)
+{
+    uint32_t after_seq;
+    if (!data_json_parse_token(token, &after_seq)) {
+        return -1;
+    }
+    uint32_t newest = get_sample_seq();
+    uint32_t oldest;
+    get_samples_since(newest, NULL, 0, &oldest);
+    // 同一次启动内序号不会超过最新的，超过说明令牌是伪造或损坏的
+    if (after_seq > newest) {
+        return -1;
+    }
+    uint32_t count = newest - after_seq;
+    // 缺口的开头已被覆盖，或者缺的样本超过调用者一次能接收的数量
+    if (count > 0 && (oldest == 0 || after_seq + 1 < oldest || count > (uint32_t)max)) {
+        return -1;
+    }
+    return data_json_samples(w, after_seq, count);
+}
@@ -0,0 +1,64 @@
+#ifndef DATA_JSON_H
+#define DATA_JSON_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "json_writer.h"
+
+// 数据 JSON 的字段分组，增量推送时按组选择要发送的内容
+#define DATA_JSON_LIVE     (1u << 0) // 实时温湿度
+#define DATA_JSON_TODAY    (1u << 1) // 今日极值
+#define DATA_JSON_ALARM    (1u << 2) // 报警阈值
+#define DATA_JSON_HISTORY  (1u << 3) // 七天历史
+#define DATA_JSON_ALL      (DATA_JSON_LIVE | DATA_JSON_TODAY | DATA_JSON_ALARM | DATA_JSON_HISTORY)
+// 最新样本的启动 ID、序号与设备时间（"boot" / "sample_seq" / "ts"），随实时值推送给 v2 / bin 客户端，不属于完整数据
+#define DATA_JSON_SAMPLE   (1u << 4)
+
+// 样本续传令牌："<启动 ID>-<样本序号>"，启动 ID 为 8 位十六进制（即推送中的 "boot"）。
+// 设备重启后序号从头计数，只比较序号会把两次启动的样本拼在一起，所以令牌带上启动 ID
+#define DATA_JSON_TOKEN_LEN 20
+
+// 本次启动 ID 的十六进制文本（8 位，buf 至少 9 字节）
+void data_json_boot_str(char *buf, size_t size);
+
+// 解析续传令牌得到样本序号；格式不对或不是本次启动发出的返回 false，调用者按缺口（gap）处理
+bool data_json_parse_token(const char *token, uint32_t *seq);
+
+// 写出当前最新样本的 "boot" / "sample_seq"，缺口回复中告诉客户端从哪里重新开始
+void data_json_cursor(json_writer_t *w);
+
+// 完整 JSON 的缓冲区大小
+#define DATA_JSON_BUF_SIZE 2048
+
+// 把选中的字段组写成当前 JSON 对象的成员（调用者负责 json_obj_begin / json_obj_end）
+void data_json_fields(json_writer_t *w, uint32_t fields);
+
+// 生成一条 v2 推送消息：{"v": 2, "type": "snap"/"delta", "seq": N, 字段...}
+// 返回消息长度（不含结尾 '\0'），空间不足返回 -1
+int data_json_write_frame(char *buf, size_t size, bool snapshot, uint32_t seq, uint32_t fields);
+
+// 生成配网任务状态 JSON：{"job": N, "state": "...", "reason": "...", "ip": "..."}
+// ws_frame 为 true 时加上 {"v": 2, "type": "prov"} 头，作为 WebSocket 消息推送
+void data_json_prov(json_writer_t *w, bool ws_frame);
+int data_json_write_prov(char *buf, size_t size, bool ws_frame);
+
+// 最近 n 个样本的紧凑表示，写成当前 JSON 对象的成员：
+// "from_seq": 首个样本序号, "ts0": 首个样本时间, "dt": [与前一个样本的时间差(秒)...],
+// "temp": [...], "hum": [...]（一位小数），样本不足 n 个时有多少给多少，返回实际个数
+#define DATA_JSON_RECENT_DEFAULT 150    // 约 5 分钟
+int data_json_recent(json_writer_t *w, int n);
+
+// 续传令牌 token 之后的全部样本，格式同 data_json_recent，返回个数（没有新样本时为 0）；
+// 令牌无效或来自上一次启动、缺口开头已被缓冲覆盖或缺的样本超过 max 个时什么也不写，返回 -1
+int data_json_since(json_writer_t *w, const char *token, int max);
+
+// 生成完整数据 JSON（旧版 WebSocket 帧使用），返回长度，空间不足返回 -1
+int data_json_write_full(char *buf, size_t size);
+
+// 生成首页注入的初始状态：完整数据字段 + "boot" / "sample_seq" / "ts"，
+// 以及设备时钟 "clock": {"ts": 设备时间, "synced": 是否已对时, "source": "ntp"/"web"/"none"}
+// 内容只有数字和固定字符串，可以直接放进 <script>；返回长度，空间不足返回 -1
+int data_json_write_boot(char *buf, size_t size);
+
+#endif // DATA_JSON_H
@@ -0,0 +1,311 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "cJSON.h"
+#include "data_process.h"
+#include "settings.h"
+#include "data_json.h"
+#include "json_writer.h"
+#include "ws_bin.h"
+#include "json_reader.h"
+#include "web_session.h"
+#include "web_ctrl.h"
+#include "diag_bench.h"
+
+static const char *TAG = "BENCH";
+
+#define BENCH_DEFAULT_ITERATIONS 200
+#define BENCH_MAX_ITERATIONS     5000
+
+// 单项测试结果：每帧平均耗时（纳秒）与帧长度（字节）
+typedef struct {
+    uint32_t ns_per_frame;
+    int bytes;
+} bench_result_t;
+
+// 编码缓冲区：在异步工作线程中执行，可能并发，每次测试从堆上分配
+typedef struct {
+    char text[DATA_JSON_BUF_SIZE + 64];
+    uint8_t bin[WS_BIN_MAX_FRAME];
+} bench_buf_t;
+
+static bench_result_t bench_text(bench_buf_t *b, int iterations, bool snapshot, uint32_t fields)
+{
+    bench_result_t r = {0};
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < iterations; i++) {
+        r.bytes = data_json_write_frame(b->text, sizeof(b->text), snapshot, (uint32_t)i, fields);
+    }
+    r.ns_per_frame = (uint32_t)((esp_timer_get_time() - start) * 1000 / iterations);
+    return r;
+}
+
+static bench_result_t bench_bin(bench_buf_t *b, int iterations, bool snapshot, uint32_t fields)
+{
+    bench_result_t r = {0};
+    uint8_t type = snapshot ? WS_BIN_TYPE_SNAP : WS_BIN_TYPE_DELTA;
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < iterations; i++) {
+        r.bytes = ws_bin_encode(b->bin, sizeof(b->bin), type, (uint32_t)i, fields);
+    }
+    r.ns_per_frame = (uint32_t)((esp_timer_get_time() - start) * 1000 / iterations);
+    return r;
+}
+
+// 旧实现的完整数据 JSON：snprintf 逐段追加，小数走 newlib 的 %f，仅作对照基准
+#define BENCH_APPEND(buf, size, offset, ...) do { \
+    if ((offset) >= 0) { \
+        int _n = snprintf((buf) + (offset), (size) - (offset), __VA_ARGS__); \
+        (offset) = (_n < 0 || (size_t)_n >= (size) - (offset)) ? -1 : (offset) + _n; \
+    } \
+} while (0)
+
+static int bench_sprintf_all(char *buf, size_t size)
+{
+    int offset = 0;
+    float max_t, min_t, max_h, min_h;
+    DailyData history[7];
+    get_today_stats(&max_t, &min_t, &max_h, &min_h);
+    get_weekly_history(history);
+
+    BENCH_APPEND(buf, size, offset, "{\"temperature\": \"%d.%d\", \"humidity\": \"%d.%d\"",
+                 get_temperature_int(), get_temperature_dec(), get_humidity_int(), get_humidity_dec());
+    BENCH_APPEND(buf, size, offset,
+                 ", \"max_temp_today\": \"%.1f\", \"min_temp_today\": \"%.1f\", "
+                 "\"max_hum_today\": \"%.1f\", \"min_hum_today\": \"%.1f\"",
+                 max_t, min_t, max_h, min_h);
+    BENCH_APPEND(buf, size, offset, ", \"alarmThreshold\": \"%.1f\", \"history\": [", settings_get_alarm_threshold());
+    for (int i = 0; i < 7; i++) {
+        const char *sep = (i == 0) ? "" : ",";
+        if (history[i].valid) {
+            BENCH_APPEND(buf, size, offset,
+                "%s{\"day_ago\": %d, \"weekday\": %d, \"max_temp\": %.1f, \"min_temp\": %.1f, \"max_hum\": %.1f, \"min_hum\": %.1f}",
+                sep, i + 1, history[i].weekday, history[i].max_temp, history[i].min_temp,
+                history[i].max_hum, history[i].min_hum);
+        } else {
+            BENCH_APPEND(buf, size, offset, "%snull", sep);
+        }
+    }
+    BENCH_APPEND(buf, size, offset, "]}");
+    return offset;
+}
+
+static bench_result_t bench_json_sprintf(bench_buf_t *b, int iterations)
+{
+    bench_result_t r = {0};
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < iterations; i++) {
+        r.bytes = bench_sprintf_all(b->text, sizeof(b->text));
+    }
+    r.ns_per_frame = (uint32_t)((esp_timer_get_time() - start) * 1000 / iterations);
+    return r;
+}
+
+static bench_result_t bench_json_writer(bench_buf_t *b, int iterations)
+{
+    bench_result_t r = {0};
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < iterations; i++) {
+        json_writer_t w;
+        json_writer_init_buf(&w, b->text, sizeof(b->text));
+        json_obj_begin(&w);
+        data_json_fields(&w, DATA_JSON_ALL);
+        json_obj_end(&w);
+        r.bytes = json_writer_finish(&w);
+    }
+    r.ns_per_frame = (uint32_t)((esp_timer_get_time() - start) * 1000 / iterations);
+    return r;
+}
+
+// 请求体解析：cJSON 建树后取字段，对比就地切分 + 字段表提取
+// 就地解析会改写输入，每次先把请求体复制到接收缓冲（与实际处理时一致，计入耗时）
+typedef struct {
+    uint32_t ns_per_parse;
+    uint32_t allocs;        // 每次解析的堆分配次数，需开启 CONFIG_HOME_ALLOC_CHECK
+} bench_parse_result_t;
+
+typedef struct {
+    const char *name;
+    const char *body;
+} bench_payload_t;
+
+static const bench_payload_t s_parse_payloads[] = {
+    { "set_alarm",   "{\"threshold\": 31.5}" },
+    { "wifi_config", "{\"ssid\": \"HomeNet-2.4G\", \"password\": \"correct horse \\\"battery\\\"\"}" },
+    { "ws_request",  "{\"id\": 42, \"op\": \"set_alarm\", \"threshold\": 31.5}" },
+};
+#define BENCH_PARSE_PAYLOADS (sizeof(s_parse_payloads) / sizeof(s_parse_payloads[0]))
+
+// 读出与 web_ctrl 相同的字段，防止编译器把解析优化掉
+static volatile int32_t s_bench_sink;
+
+static bench_parse_result_t bench_parse_cjson(const char *body, int iterations)
+{
+    bench_parse_result_t r = {0};
+    uint32_t allocs = web_alloc_count();
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < iterations; i++) {
+        cJSON *root = cJSON_Parse(body);
+        const cJSON *threshold = cJSON_GetObjectItem(root, "threshold");
+        const cJSON *ssid = cJSON_GetObjectItem(root, "ssid");
+        const cJSON *pwd = cJSON_GetObjectItem(root, "password");
+        const cJSON *id = cJSON_GetObjectItem(root, "id");
+        const cJSON *op = cJSON_GetObjectItem(root, "op");
+        if (cJSON_IsNumber(threshold)) {
+            s_bench_sink = (int32_t)(threshold->valuedouble * 10);
+        }
+        if (cJSON_IsString(ssid) && cJSON_IsString(pwd)) {
+            s_bench_sink = (int32_t)strlen(ssid->valuestring) + (int32_t)strlen(pwd->valuestring);
+        }
+        if (cJSON_IsNumber(id) && cJSON_IsString(op)) {
+            s_bench_sink = (int32_t)id->valuedouble + op->valuestring[0];
+        }
+        cJSON_Delete(root);
+    }
+    r.ns_per_parse = (uint32_t)((esp_timer_get_time() - start) * 1000 / iterations);
+    r.allocs = (web_alloc_count() - allocs) / iterations;
+    return r;
+}
+
+static bench_parse_result_t bench_parse_reader(const char *body, char *buf, int iterations)
+{
+    typedef struct {
+        int32_t id;
+        const char *op;
+    } envelope_t;
+    static const json_field_t envelope_fields[] = {
+        { "id", JSON_FIELD_INT, false, offsetof(envelope_t, id), 0, INT32_MAX },
+        { "op", JSON_FIELD_STR, true,  offsetof(envelope_t, op), 1, 16 },
+    };
+
+    bench_parse_result_t r = {0};
+    size_t len = strlen(body);
+    uint32_t allocs = web_alloc_count();
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < iterations; i++) {
+        memcpy(buf, body, len + 1);
+        json_tok_t toks[JSON_READER_MAX_TOKENS];
+        int count = json_parse(buf, len, toks, JSON_READER_MAX_TOKENS);
+        web_ctrl_alarm_args_t alarm;
+        web_ctrl_wifi_args_t wifi;
+        envelope_t env;
+        if (json_extract(buf, toks, count, web_ctrl_wifi_fields, WEB_CTRL_WIFI_FIELDS, &wifi) == JSON_OK) {
+            s_bench_sink = (int32_t)strlen(wifi.ssid) + (int32_t)strlen(wifi.password);
+        }
+        if (json_extract(buf, toks, count, envelope_fields, 2, &env) == JSON_OK) {
+            s_bench_sink = env.id + env.op[0];
+        }
+        if (json_extract(buf, toks, count, web_ctrl_alarm_fields, WEB_CTRL_ALARM_FIELDS, &alarm) == JSON_OK) {
+            s_bench_sink = alarm.threshold_x10;
+        }
+    }
+    r.ns_per_parse = (uint32_t)((esp_timer_get_time() - start) * 1000 / iterations);
+    r.allocs = (web_alloc_count() - allocs) / iterations;
+    return r;
+}
+
+static void bench_write_parse(json_writer_t *w, const char *key, bench_parse_result_t r)
+{
+    json_key(w, key);
+    json_obj_begin(w);
+    json_kv_uint(w, "ns_per_parse", r.ns_per_parse);
+    json_kv_uint(w, "allocs", r.allocs);
+    json_obj_end(w);
+}
+
+// 输出一项结果：{"bytes": N, "ns_per_frame": N}
+static void bench_write_result(json_writer_t *w, const char *key, bench_result_t r)
+{
+    json_key(w, key);
+    json_obj_begin(w);
+    json_kv_int(w, "bytes", r.bytes);
+    json_kv_uint(w, "ns_per_frame", r.ns_per_frame);
+    json_obj_end(w);
+}
+
+esp_err_t diag_bench_handler(httpd_req_t *req)
+{
+    int iterations = BENCH_DEFAULT_ITERATIONS;
+    char query[32];
+    char val[8];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "n", val, sizeof(val)) == ESP_OK) {
+        iterations = atoi(val);
+    }
+    if (iterations <= 0 || iterations > BENCH_MAX_ITERATIONS) {
+        iterations = BENCH_DEFAULT_ITERATIONS;
+    }
+
+    bench_buf_t *b = malloc(sizeof(bench_buf_t));
+    if (b == NULL) {
+        httpd_resp_send_500(req);
+        return ESP_ERR_NO_MEM;
+    }
+
+    // 快照 = 全部字段；稳态增量 = 只有实时读数
+    bench_result_t text_snap = bench_text(b, iterations, true, DATA_JSON_ALL);
+    bench_result_t text_delta = bench_text(b, iterations, false, DATA_JSON_LIVE);
+    bench_result_t bin_snap = bench_bin(b, iterations, true, DATA_JSON_ALL);
+    bench_result_t bin_delta = bench_bin(b, iterations, false, DATA_JSON_LIVE);
+    // 完整数据 JSON：旧的 snprintf/%f 路径对比流式生成器
+    bench_result_t json_sprintf = bench_json_sprintf(b, iterations);
+    bench_result_t json_writer = bench_json_writer(b, iterations);
+    // 请求体解析：期间让 cJSON 走堆（与没有会话内存池时相同），结束后恢复本请求的内存池
+    bench_parse_result_t parse_cjson[BENCH_PARSE_PAYLOADS];
+    bench_parse_result_t parse_reader[BENCH_PARSE_PAYLOADS];
+    web_request_begin(NULL);
+    for (size_t i = 0; i < BENCH_PARSE_PAYLOADS; i++) {
+        parse_cjson[i] = bench_parse_cjson(s_parse_payloads[i].body, iterations);
+        parse_reader[i] = bench_parse_reader(s_parse_payloads[i].body, b->text, iterations);
+        ESP_LOGI(TAG, "请求体解析 %s: cJSON %lu ns / %lu 次分配, 就地解析 %lu ns / %lu 次分配",
+                 s_parse_payloads[i].name,
+                 (unsigned long)parse_cjson[i].ns_per_parse, (unsigned long)parse_cjson[i].allocs,
+                 (unsigned long)parse_reader[i].ns_per_parse, (unsigned long)parse_reader[i].allocs);
+    }
+    web_request_begin(web_session_get(req));
+    free(b);
+
+    ESP_LOGI(TAG, "WS 编码: 文本快照 %d B / %lu ns, 文本增量 %d B / %lu ns, 二进制快照 %d B / %lu ns, 二进制增量 %d B / %lu ns",
+             text_snap.bytes, (unsigned long)text_snap.ns_per_frame,
+             text_delta.bytes, (unsigned long)text_delta.ns_per_frame,
+             bin_snap.bytes, (unsigned long)bin_snap.ns_per_frame,
+             bin_delta.bytes, (unsigned long)bin_delta.ns_per_frame);
+    ESP_LOGI(TAG, "完整 JSON: snprintf %d B / %lu ns, 流式生成器 %d B / %lu ns",
+             json_sprintf.bytes, (unsigned long)json_sprintf.ns_per_frame,
+             json_writer.bytes, (unsigned long)json_writer.ns_per_frame);
+
+    char response[512];
+    json_writer_t w;
+    json_writer_init_http(&w, req, response, sizeof(response));
+    httpd_resp_set_type(req, "application/json");
+    json_obj_begin(&w);
+    json_kv_int(&w, "iterations", iterations);
+    json_key(&w, "ws_encode");
+    json_obj_begin(&w);
+    bench_write_result(&w, "text_snap", text_snap);
+    bench_write_result(&w, "text_delta", text_delta);
+    bench_write_result(&w, "bin_snap", bin_snap);
+    bench_write_result(&w, "bin_delta", bin_delta);
+    json_obj_end(&w);
+    json_key(&w, "json_full");
+    json_obj_begin(&w);
+    bench_write_result(&w, "sprintf", json_sprintf);
+    bench_write_result(&w, "writer", json_writer);
+    json_obj_end(&w);
+    json_key(&w, "json_parse");
+    json_obj_begin(&w);
+    for (size_t i = 0; i < BENCH_PARSE_PAYLOADS; i++) {
+        json_key(&w, s_parse_payloads[i].name);
+        json_obj_begin(&w);
+        json_kv_int(&w, "bytes", (int64_t)strlen(s_parse_payloads[i].body));
+        bench_write_parse(&w, "cjson", parse_cjson[i]);
+        bench_write_parse(&w, "reader", parse_reader[i]);
+        json_obj_end(&w);
+    }
+    json_obj_end(&w);
+    json_obj_end(&w);
+    return json_writer_send(&w);
+}
@@ -0,0 +1,9 @@
+#ifndef DIAG_BENCH_H
+#define DIAG_BENCH_H
+
+#include "esp_http_server.h"
+
+// GET /diag/bench?n=迭代次数：在设备上对比各编码路径的耗时与字节数，返回 JSON
+esp_err_t diag_bench_handler(httpd_req_t *req);
+
+#endif // DIAG_BENCH_H
@@ -0,0 +1,66 @@
+#include <stdlib.h>
+#include "sdkconfig.h"
+#include "trace.h"
+#include "diag_trace.h"
+#include "json_writer.h"
+
+#if CONFIG_HOME_TRACE_ENABLE
+
+// 输出缓冲大小：写满一段作为一个 chunk 发出
+#define DIAG_TRACE_BUF_SIZE 768
+
+// 每个区间输出一个完整事件（ph = X），tid 为核心号
+static void trace_out_span(void *arg, trace_span_id_t id, int core, int64_t start_us, uint32_t dur_us)
+{
+    json_writer_t *w = (json_writer_t *)arg;
+    json_obj_begin(w);
+    json_kv_str(w, "name", trace_span_name(id));
+    json_kv_str(w, "ph", "X");
+    json_kv_int(w, "ts", start_us);
+    json_kv_uint(w, "dur", dur_us);
+    json_kv_int(w, "pid", 1);
+    json_kv_int(w, "tid", core);
+    json_obj_end(w);
+}
+
+#endif // CONFIG_HOME_TRACE_ENABLE
+
+esp_err_t diag_trace_handler(httpd_req_t *req)
+{
+#if CONFIG_HOME_TRACE_ENABLE
+    // 输出缓冲放在堆上：导出可能较慢，不占 httpd 任务栈
+    char *buf = malloc(DIAG_TRACE_BUF_SIZE);
+    if (buf == NULL) {
+        httpd_resp_send_500(req);
+        return ESP_ERR_NO_MEM;
+    }
+    json_writer_t w;
+    json_writer_init_http(&w, req, buf, DIAG_TRACE_BUF_SIZE);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"trace.json\"");
+    json_obj_begin(&w);
+    json_kv_str(&w, "displayTimeUnit", "ms");
+    json_key(&w, "traceEvents");
+    json_arr_begin(&w);
+    json_raw(&w, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"ESP32-S3\"}}");
+    json_raw(&w, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, \"args\": {\"name\": \"core 0\"}}");
+    json_raw(&w, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 1, \"args\": {\"name\": \"core 1\"}}");
+    trace_foreach(trace_out_span, &w);
+    json_arr_end(&w);
+    // 区间内被迁移到另一个核心、耗时不可信而丢弃的区间数
+    json_key(&w, "otherData");
+    json_obj_begin(&w);
+    json_kv_uint(&w, "migrated_spans", trace_migrated_count());
+    json_obj_end(&w);
+    json_obj_end(&w);
+    esp_err_t ret = json_writer_send(&w);
+    free(buf);
+    return ret;
+#else
+    httpd_resp_set_status(req, HTTPD_404);
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_sendstr(req, "{\"error\": \"tracing disabled, enable CONFIG_HOME_TRACE_ENABLE\"}");
+#endif
+}
@@ -0,0 +1,10 @@
+#ifndef DIAG_TRACE_H
+#define DIAG_TRACE_H
+
+#include "esp_http_server.h"
+
+// GET /diag/trace：把各核心环形缓冲中的追踪区间导出为 Chrome trace_event JSON
+// 保存为文件后直接拖进 Perfetto (ui.perfetto.dev) 查看；需要开启 CONFIG_HOME_TRACE_ENABLE
+esp_err_t diag_trace_handler(httpd_req_t *req);
+
+#endif // DIAG_TRACE_H
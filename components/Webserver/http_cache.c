@@ -0,0 +1,41 @@
+#include <stdio.h>
+#include <string.h>
+#include "esp_random.h"
+#include "http_cache.h"
+
+static uint32_t s_boot_id = 0;
+
+uint32_t http_cache_boot_id(void)
+{
+    if (s_boot_id == 0) {
+        s_boot_id = esp_random() | 1; // 保证非 0
+    }
+    return s_boot_id;
+}
+
+void http_cache_make_etag(char *etag, size_t size, const char *prefix, uint32_t gen)
+{
+    snprintf(etag, size, "\"%08lx-%s%lu\"", (unsigned long)http_cache_boot_id(), prefix, (unsigned long)gen);
+}
+
+bool http_cache_etag_matches(httpd_req_t *req, const char *etag)
+{
+    char inm[128];
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", inm, sizeof(inm)) != ESP_OK) {
+        return false;
+    }
+    // If-None-Match 可能是逗号分隔的列表，也可能是 *
+    return strcmp(inm, "*") == 0 || strstr(inm, etag) != NULL;
+}
+
+bool http_cache_check(httpd_req_t *req, const char *etag, const char *cache_control)
+{
+    httpd_resp_set_hdr(req, "ETag", etag);
+    httpd_resp_set_hdr(req, "Cache-Control", cache_control);
+    if (!http_cache_etag_matches(req, etag)) {
+        return false;
+    }
+    httpd_resp_set_status(req, "304 Not Modified");
+    httpd_resp_send(req, NULL, 0);
+    return true;
+}
@@ -0,0 +1,26 @@
+#ifndef HTTP_CACHE_H
+#define HTTP_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_http_server.h"
+
+// ETag 最大长度（含引号和结尾 '\0'）
+#define HTTP_ETAG_LEN 32
+
+// 本次启动的随机 ID（非 0），每次上电重新生成；也用于样本续传令牌，区分重启前后重新计数的序号
+uint32_t http_cache_boot_id(void);
+
+// 由前缀和版本号生成强 ETag："<启动ID>-<前缀><版本号>"
+// 启动 ID 每次上电随机生成，防止重启后版本号归零与旧缓存撞号
+void http_cache_make_etag(char *etag, size_t size, const char *prefix, uint32_t gen);
+
+// 请求的 If-None-Match 是否命中当前 ETag
+bool http_cache_etag_matches(httpd_req_t *req, const char *etag);
+
+// 设置 ETag / Cache-Control 响应头；命中时直接回 304 并返回 true，调用者不用再发送正文
+// etag 和 cache_control 必须在响应发出前保持有效
+bool http_cache_check(httpd_req_t *req, const char *etag, const char *cache_control);
+
+#endif // HTTP_CACHE_H
@@ -0,0 +1,486 @@
+#include <string.h>
+#include "json_reader.h"
+
+typedef struct {
+    const char *buf;
+    size_t len;
+    size_t pos;
+    json_tok_t *toks;
+    int max;
+    int count;
+} json_parser_t;
+
+static void skip_ws(json_parser_t *p)
+{
+    while (p->pos < p->len) {
+        char c = p->buf[p->pos];
+        if (c != ' ' && c != '\t' && c != '\n' && c != '\r') {
+            break;
+        }
+        p->pos++;
+    }
+}
+
+static int peek(const json_parser_t *p)
+{
+    return p->pos < p->len ? (unsigned char)p->buf[p->pos] : -1;
+}
+
+static int new_tok(json_parser_t *p, uint8_t type, size_t start)
+{
+    if (p->count >= p->max) {
+        return JSON_ERR_NOMEM;
+    }
+    json_tok_t *t = &p->toks[p->count];
+    t->type = type;
+    t->start = (uint16_t)start;
+    t->end = (uint16_t)start;
+    t->size = 0;
+    return p->count++;
+}
+
+static int hex_val(int c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static bool is_digit(int c)
+{
+    return c >= '0' && c <= '9';
+}
+
+// 当前位置为开引号；只校验转义格式，反转义留到提取时
+static int parse_string(json_parser_t *p)
+{
+    int idx = new_tok(p, JSON_TOK_STRING, p->pos + 1);
+    if (idx < 0) {
+        return idx;
+    }
+    p->pos++;
+    while (p->pos < p->len) {
+        unsigned char c = (unsigned char)p->buf[p->pos];
+        if (c == '"') {
+            p->toks[idx].end = (uint16_t)p->pos;
+            p->pos++;
+            return idx;
+        }
+        if (c < 0x20) {
+            return JSON_ERR_SYNTAX;
+        }
+        if (c == '\\') {
+            if (++p->pos >= p->len) {
+                return JSON_ERR_SYNTAX;
+            }
+            c = (unsigned char)p->buf[p->pos];
+            if (c == 'u') {
+                for (int i = 0; i < 4; i++) {
+                    if (++p->pos >= p->len || hex_val((unsigned char)p->buf[p->pos]) < 0) {
+                        return JSON_ERR_SYNTAX;
+                    }
+                }
+            } else if (strchr("\"\\/bfnrt", c) == NULL || c == '\0') {
+                return JSON_ERR_SYNTAX;
+            }
+        }
+        p->pos++;
+    }
+    return JSON_ERR_SYNTAX;
+}
+
+static bool match_literal(json_parser_t *p, const char *lit)
+{
+    size_t n = strlen(lit);
+    if (p->len - p->pos < n || memcmp(p->buf + p->pos, lit, n) != 0) {
+        return false;
+    }
+    p->pos += n;
+    return true;
+}
+
+// 数字按 JSON 语法严格校验：-?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+static int parse_primitive(json_parser_t *p)
+{
+    int idx = new_tok(p, JSON_TOK_PRIMITIVE, p->pos);
+    if (idx < 0) {
+        return idx;
+    }
+    int c = peek(p);
+    if (c == 't' || c == 'f' || c == 'n') {
+        if (!match_literal(p, "true") && !match_literal(p, "false") && !match_literal(p, "null")) {
+            return JSON_ERR_SYNTAX;
+        }
+    } else {
+        if (c == '-') {
+            p->pos++;
+        }
+        if (peek(p) == '0') {
+            p->pos++;
+        } else if (is_digit(peek(p))) {
+            while (is_digit(peek(p))) p->pos++;
+        } else {
+            return JSON_ERR_SYNTAX;
+        }
+        if (peek(p) == '.') {
+            p->pos++;
+            if (!is_digit(peek(p))) {
+                return JSON_ERR_SYNTAX;
+            }
+            while (is_digit(peek(p))) p->pos++;
+        }
+        if (peek(p) == 'e' || peek(p) == 'E') {
+            p->pos++;
+            if (peek(p) == '+' || peek(p) == '-') {
+                p->pos++;
+            }
+            if (!is_digit(peek(p))) {
+                return JSON_ERR_SYNTAX;
+            }
+            while (is_digit(peek(p))) p->pos++;
+        }
+    }
+    p->toks[idx].end = (uint16_t)p->pos;
+    return idx;
+}
+
+static int parse_value(json_parser_t *p, int depth)
+{
+    skip_ws(p);
+    int c = peek(p);
+    if (c == '"') {
+        return parse_string(p);
+    }
+    if (c != '{' && c != '[') {
+        return parse_primitive(p);
+    }
+    if (depth >= JSON_READER_MAX_DEPTH) {
+        return JSON_ERR_SYNTAX;
+    }
+
+    bool is_obj = (c == '{');
+    int close = is_obj ? '}' : ']';
+    int idx = new_tok(p, is_obj ? JSON_TOK_OBJECT : JSON_TOK_ARRAY, p->pos);
+    if (idx < 0) {
+        return idx;
+    }
+    p->pos++;
+    skip_ws(p);
+    if (peek(p) == close) {
+        p->pos++;
+        p->toks[idx].end = (uint16_t)p->pos;
+        return idx;
+    }
+
+    for (;;) {
+        if (is_obj) {
+            skip_ws(p);
+            if (peek(p) != '"') {
+                return JSON_ERR_SYNTAX;
+            }
+            int key = parse_string(p);
+            if (key < 0) {
+                return key;
+            }
+            p->toks[key].size = 1;
+            skip_ws(p);
+            if (peek(p) != ':') {
+                return JSON_ERR_SYNTAX;
+            }
+            p->pos++;
+        }
+        int r = parse_value(p, depth + 1);
+        if (r < 0) {
+            return r;
+        }
+        p->toks[idx].size++;
+        skip_ws(p);
+        c = peek(p);
+        if (c == ',') {
+            p->pos++;
+        } else if (c == close) {
+            p->pos++;
+            p->toks[idx].end = (uint16_t)p->pos;
+            return idx;
+        } else {
+            return JSON_ERR_SYNTAX;
+        }
+    }
+}
+
+int json_parse(const char *buf, size_t len, json_tok_t *toks, int max_toks)
+{
+    // token 里的偏移是 16 位的
+    if (len > UINT16_MAX) {
+        return JSON_ERR_SYNTAX;
+    }
+    json_parser_t p = { .buf = buf, .len = len, .toks = toks, .max = max_toks };
+    int r = parse_value(&p, 0);
+    if (r < 0) {
+        return r;
+    }
+    skip_ws(&p);
+    if (p.pos != len) {
+        return JSON_ERR_SYNTAX;
+    }
+    return p.count;
+}
+
+// 跳过以 i 开头的整个值，返回其后的 token 下标
+static int skip_tok(const json_tok_t *toks, int count, int i)
+{
+    // 还需要跳过的 token 数：每遇到一个 token，加上它的直接子元素个数
+    int pending = 1;
+    while (pending > 0 && i < count) {
+        pending += toks[i].size - 1;
+        i++;
+    }
+    return i;
+}
+
+static int read_int(const char *s, size_t n, int32_t *out)
+{
+    size_t i = 0;
+    bool neg = (n > 0 && s[0] == '-');
+    if (neg) {
+        i++;
+    }
+    int64_t v = 0;
+    for (; i < n; i++) {
+        if (!is_digit((unsigned char)s[i])) {
+            return JSON_ERR_TYPE;   // 小数或指数
+        }
+        v = v * 10 + (s[i] - '0');
+        if (v > (int64_t)INT32_MAX + 1) {
+            return JSON_ERR_RANGE;
+        }
+    }
+    v = neg ? -v : v;
+    if (v > INT32_MAX) {
+        return JSON_ERR_RANGE;
+    }
+    *out = (int32_t)v;
+    return JSON_OK;
+}
+
+// 一位小数的定点数：取第一位小数，第二位小数四舍五入（远离零）
+static int read_fixed1(const char *s, size_t n, int32_t *out)
+{
+    size_t i = 0;
+    bool neg = (n > 0 && s[0] == '-');
+    if (neg) {
+        i++;
+    }
+    int64_t v = 0;
+    for (; i < n && s[i] != '.'; i++) {
+        if (!is_digit((unsigned char)s[i])) {
+            return JSON_ERR_TYPE;
+        }
+        v = v * 10 + (s[i] - '0');
+        if (v > INT32_MAX / 10) {
+            return JSON_ERR_RANGE;
+        }
+    }
+    v *= 10;
+    if (i < n) {
+        i++;    // '.'
+        for (size_t k = 0; i < n; i++, k++) {
+            if (!is_digit((unsigned char)s[i])) {
+                return JSON_ERR_TYPE;
+            }
+            if (k == 0) {
+                v += s[i] - '0';
+            } else if (k == 1 && s[i] >= '5') {
+                v++;
+            }
+        }
+    }
+    if (v > INT32_MAX) {
+        return JSON_ERR_RANGE;
+    }
+    *out = (int32_t)(neg ? -v : v);
+    return JSON_OK;
+}
+
+// 把 cp 编码成 UTF-8 写到 w，返回写入的字节数
+static size_t put_utf8(char *w, uint32_t cp)
+{
+    if (cp < 0x80) {
+        w[0] = (char)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        w[0] = (char)(0xC0 | (cp >> 6));
+        w[1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        w[0] = (char)(0xE0 | (cp >> 12));
+        w[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        w[2] = (char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    w[0] = (char)(0xF0 | (cp >> 18));
+    w[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+    w[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    w[3] = (char)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+static uint32_t read_hex4(const char *s)
+{
+    return ((uint32_t)hex_val((unsigned char)s[0]) << 12) | ((uint32_t)hex_val((unsigned char)s[1]) << 8) |
+           ((uint32_t)hex_val((unsigned char)s[2]) << 4) | (uint32_t)hex_val((unsigned char)s[3]);
+}
+
+// 就地反转义（转义序列总比解出来的字节长），写入 '\0' 后返回字节长度；
+// \u0000 和不成对的代理项返回 JSON_ERR_TYPE
+static int unescape(char *buf, const json_tok_t *t)
+{
+    char *r = buf + t->start;
+    char *end = buf + t->end;
+    char *w = r;
+    while (r < end) {
+        if (*r != '\\') {
+            *w++ = *r++;
+            continue;
+        }
+        r++;
+        char c = *r++;
+        switch (c) {
+        case 'b': *w++ = '\b'; break;
+        case 'f': *w++ = '\f'; break;
+        case 'n': *w++ = '\n'; break;
+        case 'r': *w++ = '\r'; break;
+        case 't': *w++ = '\t'; break;
+        case 'u': {
+            uint32_t cp = read_hex4(r);
+            r += 4;
+            if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                return JSON_ERR_TYPE;
+            }
+            if (cp >= 0xD800 && cp <= 0xDBFF) {
+                if (end - r < 6 || r[0] != '\\' || r[1] != 'u') {
+                    return JSON_ERR_TYPE;
+                }
+                uint32_t lo = read_hex4(r + 2);
+                if (lo < 0xDC00 || lo > 0xDFFF) {
+                    return JSON_ERR_TYPE;
+                }
+                r += 6;
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+            }
+            if (cp == 0) {
+                return JSON_ERR_TYPE;
+            }
+            w += put_utf8(w, cp);
+            break;
+        }
+        default: *w++ = c; break;   // \" \\ \/
+        }
+    }
+    *w = '\0';
+    return (int)(w - (buf + t->start));
+}
+
+static int read_field(char *buf, const json_tok_t *t, const json_field_t *f, void *out)
+{
+    char *dst = (char *)out + f->offset;
+    const char *s = buf + t->start;
+    size_t n = t->end - t->start;
+
+    if (f->type == JSON_FIELD_STR) {
+        if (t->type != JSON_TOK_STRING) {
+            return JSON_ERR_TYPE;
+        }
+        int len = unescape(buf, t);
+        if (len < 0) {
+            return len;
+        }
+        if (len < f->min || len > f->max) {
+            return JSON_ERR_RANGE;
+        }
+        const char *str = s;
+        memcpy(dst, &str, sizeof(str));
+        return JSON_OK;
+    }
+
+    if (t->type != JSON_TOK_PRIMITIVE) {
+        return JSON_ERR_TYPE;
+    }
+    if (f->type == JSON_FIELD_BOOL) {
+        bool b;
+        if (n == 4 && memcmp(s, "true", 4) == 0) {
+            b = true;
+        } else if (n == 5 && memcmp(s, "false", 5) == 0) {
+            b = false;
+        } else {
+            return JSON_ERR_TYPE;
+        }
+        memcpy(dst, &b, sizeof(b));
+        return JSON_OK;
+    }
+
+    // 数字的语法已在切分时校验过，这里只剩 true / false / null 要排除
+    if (s[0] != '-' && !is_digit((unsigned char)s[0])) {
+        return JSON_ERR_TYPE;
+    }
+    int32_t v;
+    int r = (f->type == JSON_FIELD_INT) ? read_int(s, n, &v) : read_fixed1(s, n, &v);
+    if (r != JSON_OK) {
+        return r;
+    }
+    if (v < f->min || v > f->max) {
+        return JSON_ERR_RANGE;
+    }
+    memcpy(dst, &v, sizeof(v));
+    return JSON_OK;
+}
+
+int json_extract(char *buf, const json_tok_t *toks, int count,
+                 const json_field_t *fields, int n_fields, void *out)
+{
+    if (count < 1 || toks[0].type != JSON_TOK_OBJECT) {
+        return JSON_ERR_MISSING;
+    }
+
+    uint32_t seen = 0;  // 字段表不超过 32 项
+    int i = 1;
+    for (int k = 0; k < toks[0].size && i + 1 < count; k++) {
+        const json_tok_t *key = &toks[i];
+        size_t klen = key->end - key->start;
+        for (int f = 0; f < n_fields && f < 32; f++) {
+            if (strlen(fields[f].key) != klen || memcmp(buf + key->start, fields[f].key, klen) != 0) {
+                continue;
+            }
+            // 重复的键以第一次出现的为准
+            if (!(seen & (1u << f))) {
+                int r = read_field(buf, &toks[i + 1], &fields[f], out);
+                if (r != JSON_OK) {
+                    return r;
+                }
+                seen |= 1u << f;
+            }
+            break;
+        }
+        i = skip_tok(toks, count, i + 1);
+    }
+
+    for (int f = 0; f < n_fields && f < 32; f++) {
+        if (fields[f].required && !(seen & (1u << f))) {
+            return JSON_ERR_MISSING;
+        }
+    }
+    return JSON_OK;
+}
+
+int json_read(char *buf, size_t len, const json_field_t *fields, int n_fields, void *out)
+{
+    json_tok_t toks[JSON_READER_MAX_TOKENS];
+    int count = json_parse(buf, len, toks, JSON_READER_MAX_TOKENS);
+    if (count < 0) {
+        return count;
+    }
+    return json_extract(buf, toks, count, fields, n_fields, out);
+}
@@ -0,0 +1,70 @@
+#ifndef JSON_READER_H
+#define JSON_READER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// 小请求体（控制命令）的就地 JSON 解析，jsmn 风格：
+// json_parse 一遍扫描把输入切成 token，只记录类型、在缓冲区中的位置和直接子元素个数，不分配内存也不复制；
+// json_extract 按字段表从顶层对象中取值，校验类型与范围后写进调用者的结构体。
+// 字符串就地反转义并以 '\0' 结尾，结构体中存放的是指向原缓冲区的指针，使用结果期间缓冲区须保持有效。
+// 数字只接受整数和小数（带指数的按类型不符处理），全程不经过 strtod，不会触发 newlib 的堆分配
+
+// 最大嵌套层数（对象 / 数组）
+#define JSON_READER_MAX_DEPTH   8
+// json_read 在栈上使用的 token 数，足够放下所有控制命令
+#define JSON_READER_MAX_TOKENS  24
+
+typedef enum {
+    JSON_TOK_OBJECT = 1,
+    JSON_TOK_ARRAY,
+    JSON_TOK_STRING,
+    JSON_TOK_PRIMITIVE,     // 数字、true、false、null
+} json_tok_type_t;
+
+typedef struct {
+    uint8_t type;           // json_tok_type_t
+    uint16_t start;         // 在缓冲区中的起始偏移（字符串不含引号）
+    uint16_t end;           // 结束偏移（不含）
+    uint16_t size;          // 直接子元素个数：对象为键数，数组为元素数，对象的键为 1（它的值）
+} json_tok_t;
+
+// 返回值
+#define JSON_OK             0
+#define JSON_ERR_SYNTAX     (-1)    // 不是合法的 JSON（含尾随内容、嵌套过深、输入超过 64 KB）
+#define JSON_ERR_NOMEM      (-2)    // token 数组不够用
+#define JSON_ERR_MISSING    (-3)    // 缺少必填字段，或顶层不是对象
+#define JSON_ERR_TYPE       (-4)    // 字段类型不符
+#define JSON_ERR_RANGE      (-5)    // 数值或字符串长度超出范围
+
+// 字段类型
+typedef enum {
+    JSON_FIELD_INT,         // int32_t，范围 [min, max]
+    JSON_FIELD_FIXED1,      // 一位小数，存为放大 10 倍的 int32_t（更多小数位四舍五入），范围按放大后的值
+    JSON_FIELD_BOOL,        // bool
+    JSON_FIELD_STR,         // const char *，范围为反转义后的字节长度
+} json_field_type_t;
+
+// 字段表的一项：顶层对象中的键（按原文比较，不处理转义）与输出位置
+typedef struct {
+    const char *key;
+    uint8_t type;           // json_field_type_t
+    bool required;          // 缺少时返回 JSON_ERR_MISSING；可选字段缺少时输出保持调用者的初始值
+    uint16_t offset;        // 在输出结构体中的偏移（offsetof）
+    int32_t min;
+    int32_t max;
+} json_field_t;
+
+// 切分 buf 的前 len 个字节，返回 token 个数（第一个为顶层值），失败返回 JSON_ERR_*
+int json_parse(const char *buf, size_t len, json_tok_t *toks, int max_toks);
+
+// 按字段表从 json_parse 的结果中取值，写入 out，成功返回 JSON_OK；
+// 同一组 token 可以用不同的字段表多次提取，但同一个字符串字段只能提取一次（已就地反转义）
+int json_extract(char *buf, const json_tok_t *toks, int count,
+                 const json_field_t *fields, int n_fields, void *out);
+
+// json_parse + json_extract，token 数组放在栈上
+int json_read(char *buf, size_t len, const json_field_t *fields, int n_fields, void *out);
+
+#endif // JSON_READER_H
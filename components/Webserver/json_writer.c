@@ -0,0 +1,334 @@
+#include <string.h>
+#include <math.h>
+#include "json_writer.h"
+
+static const uint32_t s_pow10[] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+
+void json_writer_init_buf(json_writer_t *w, char *buf, size_t size)
+{
+    memset(w, 0, sizeof(*w));
+    w->buf = buf;
+    w->size = size;
+    w->error = (buf == NULL || size == 0);
+}
+
+void json_writer_init_http(json_writer_t *w, httpd_req_t *req, char *buf, size_t size)
+{
+    json_writer_init_buf(w, buf, size);
+    w->req = req;
+}
+
+// 把缓冲区内容作为一个 chunk 发出
+static void jw_flush(json_writer_t *w)
+{
+    if (w->len > 0 && httpd_resp_send_chunk(w->req, w->buf, w->len) != ESP_OK) {
+        w->error = true;
+    }
+    w->chunked = true;
+    w->len = 0;
+}
+
+// 写入原始字节；固定缓冲区始终给结尾 '\0' 留一个字节
+static void jw_put(json_writer_t *w, const char *s, size_t n)
+{
+    while (n > 0 && !w->error) {
+        size_t room = w->size - 1 - w->len;
+        if (room == 0) {
+            if (w->req == NULL) {
+                w->error = true;
+                return;
+            }
+            jw_flush(w);
+            continue;
+        }
+        size_t k = n < room ? n : room;
+        memcpy(w->buf + w->len, s, k);
+        w->len += k;
+        s += k;
+        n -= k;
+    }
+}
+
+static void jw_putc(json_writer_t *w, char c)
+{
+    if (!w->error && w->len + 1 < w->size) {
+        w->buf[w->len++] = c;
+    } else {
+        jw_put(w, &c, 1);
+    }
+}
+
+// 每个值（或键）之前调用：同一容器内第二个成员起补逗号
+static void jw_sep(json_writer_t *w)
+{
+    if (w->after_key) {
+        w->after_key = false;
+        return;
+    }
+    uint8_t bit = 1u << w->depth;
+    if (w->has_member & bit) {
+        jw_put(w, ", ", 2);
+    }
+    w->has_member |= bit;
+}
+
+static void jw_open(json_writer_t *w, char c)
+{
+    jw_sep(w);
+    if (w->depth + 1 >= JSON_WRITER_MAX_DEPTH) {
+        w->error = true;
+        return;
+    }
+    jw_putc(w, c);
+    w->depth++;
+    w->has_member &= ~(1u << w->depth);
+}
+
+static void jw_close(json_writer_t *w, char c)
+{
+    if (w->depth == 0) {
+        w->error = true;
+        return;
+    }
+    w->depth--;
+    jw_putc(w, c);
+}
+
+void json_obj_begin(json_writer_t *w) { jw_open(w, '{'); }
+void json_obj_end(json_writer_t *w)   { jw_close(w, '}'); }
+void json_arr_begin(json_writer_t *w) { jw_open(w, '['); }
+void json_arr_end(json_writer_t *w)   { jw_close(w, ']'); }
+
+void json_key(json_writer_t *w, const char *key)
+{
+    jw_sep(w);
+    jw_putc(w, '"');
+    jw_put(w, key, strlen(key));
+    jw_put(w, "\": ", 3);
+    w->after_key = true;
+}
+
+void json_str(json_writer_t *w, const char *s)
+{
+    static const char hex[] = "0123456789abcdef";
+    jw_sep(w);
+    jw_putc(w, '"');
+    // 连续的普通字符整段写入，只在需要转义处断开
+    const char *run = s;
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        jw_put(w, run, s - run);
+        run = s + 1;
+        char esc[6] = { '\\', 0 };
+        int n = 2;
+        switch (c) {
+        case '"':  esc[1] = '"';  break;
+        case '\\': esc[1] = '\\'; break;
+        case '\n': esc[1] = 'n';  break;
+        case '\r': esc[1] = 'r';  break;
+        case '\t': esc[1] = 't';  break;
+        default:
+            esc[1] = 'u';
+            esc[2] = '0';
+            esc[3] = '0';
+            esc[4] = hex[c >> 4];
+            esc[5] = hex[c & 0xf];
+            n = 6;
+            break;
+        }
+        jw_put(w, esc, n);
+    }
+    jw_put(w, run, s - run);
+    jw_putc(w, '"');
+}
+
+// 无符号整数转十进制，写在 tmp 末尾，返回起始位置；能用 32 位除法时避开 64 位除法
+static char *jw_utoa(char *end, uint64_t v)
+{
+    char *p = end;
+    while (v > UINT32_MAX) {
+        *--p = '0' + (char)(v % 10);
+        v /= 10;
+    }
+    uint32_t v32 = (uint32_t)v;
+    do {
+        *--p = '0' + (char)(v32 % 10);
+        v32 /= 10;
+    } while (v32);
+    return p;
+}
+
+void json_uint(json_writer_t *w, uint64_t v)
+{
+    char tmp[20];
+    char *p = jw_utoa(tmp + sizeof(tmp), v);
+    jw_sep(w);
+    jw_put(w, p, tmp + sizeof(tmp) - p);
+}
+
+void json_int(json_writer_t *w, int64_t v)
+{
+    char tmp[21];
+    uint64_t mag = v < 0 ? 0 - (uint64_t)v : (uint64_t)v;
+    char *p = jw_utoa(tmp + sizeof(tmp), mag);
+    if (v < 0) {
+        *--p = '-';
+    }
+    jw_sep(w);
+    jw_put(w, p, tmp + sizeof(tmp) - p);
+}
+
+// 定点数格式化到 tmp 末尾，返回起始位置
+static char *jw_fixed_fmt(char *end, int32_t value, uint8_t decimals)
+{
+    if (decimals > 6) {
+        decimals = 6;
+    }
+    uint32_t mag = value < 0 ? 0u - (uint32_t)value : (uint32_t)value;
+    uint32_t scale = s_pow10[decimals];
+    uint32_t frac = mag % scale;
+    char *p = end;
+    for (int i = 0; i < decimals; i++) {
+        *--p = '0' + (char)(frac % 10);
+        frac /= 10;
+    }
+    if (decimals) {
+        *--p = '.';
+    }
+    p = jw_utoa(p, mag / scale);
+    if (value < 0) {
+        *--p = '-';
+    }
+    return p;
+}
+
+void json_fixed(json_writer_t *w, int32_t value, uint8_t decimals)
+{
+    char tmp[20];
+    char *p = jw_fixed_fmt(tmp + sizeof(tmp), value, decimals);
+    jw_sep(w);
+    jw_put(w, p, tmp + sizeof(tmp) - p);
+}
+
+void json_fixed_str(json_writer_t *w, int32_t value, uint8_t decimals)
+{
+    char tmp[22];
+    char *end = tmp + sizeof(tmp) - 1;
+    *end = '"';
+    char *p = jw_fixed_fmt(end, value, decimals);
+    *--p = '"';
+    jw_sep(w);
+    jw_put(w, p, tmp + sizeof(tmp) - p);
+}
+
+void json_bool(json_writer_t *w, bool v)
+{
+    jw_sep(w);
+    if (v) {
+        jw_put(w, "true", 4);
+    } else {
+        jw_put(w, "false", 5);
+    }
+}
+
+void json_null(json_writer_t *w)
+{
+    jw_sep(w);
+    jw_put(w, "null", 4);
+}
+
+void json_raw(json_writer_t *w, const char *json)
+{
+    jw_sep(w);
+    jw_put(w, json, strlen(json));
+}
+
+void json_kv_str(json_writer_t *w, const char *key, const char *s)
+{
+    json_key(w, key);
+    json_str(w, s);
+}
+
+void json_kv_int(json_writer_t *w, const char *key, int64_t v)
+{
+    json_key(w, key);
+    json_int(w, v);
+}
+
+void json_kv_uint(json_writer_t *w, const char *key, uint64_t v)
+{
+    json_key(w, key);
+    json_uint(w, v);
+}
+
+void json_kv_bool(json_writer_t *w, const char *key, bool v)
+{
+    json_key(w, key);
+    json_bool(w, v);
+}
+
+void json_kv_fixed(json_writer_t *w, const char *key, int32_t value, uint8_t decimals)
+{
+    json_key(w, key);
+    json_fixed(w, value, decimals);
+}
+
+void json_kv_fixed_str(json_writer_t *w, const char *key, int32_t value, uint8_t decimals)
+{
+    json_key(w, key);
+    json_fixed_str(w, value, decimals);
+}
+
+int32_t json_float_to_fixed(float v, uint8_t decimals)
+{
+    if (decimals > 6) {
+        decimals = 6;
+    }
+    float scaled = v * (float)s_pow10[decimals];
+    if (!(scaled > -2147483000.0f && scaled < 2147483000.0f)) {
+        return 0; // NaN 或超出范围
+    }
+    return (int32_t)lroundf(scaled);
+}
+
+int json_writer_finish(json_writer_t *w)
+{
+    if (w->error || w->depth != 0 || w->req != NULL) {
+        if (w->buf && w->size) {
+            w->buf[0] = '\0';
+        }
+        return -1;
+    }
+    w->buf[w->len] = '\0';
+    return (int)w->len;
+}
+
+esp_err_t json_writer_send(json_writer_t *w)
+{
+    if (w->req == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (w->depth != 0) {
+        w->error = true;
+    }
+    if (w->error) {
+        if (!w->chunked) {
+            httpd_resp_send_500(w->req);
+        } else {
+            // 已发出部分正文，无法再改状态码；不发结束 chunk，直接断开让客户端感知
+            httpd_sess_trigger_close(w->req->handle, httpd_req_to_sockfd(w->req));
+        }
+        return ESP_FAIL;
+    }
+    if (!w->chunked) {
+        return httpd_resp_send(w->req, w->buf, w->len);
+    }
+    jw_flush(w);
+    if (w->error) {
+        return ESP_FAIL;
+    }
+    return httpd_resp_send_chunk(w->req, NULL, 0);
+}
@@ -0,0 +1,71 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_http_server.h"
+
+// 最大嵌套层数（对象 / 数组）
+#define JSON_WRITER_MAX_DEPTH 8
+
+// 流式 JSON 生成器：自动处理逗号和冒号，字符串自动转义，
+// 小数按定点整数输出（不经过 newlib 的 %f）。
+// 两种输出目标：
+//   - 固定缓冲区：空间不足时置错误标志，之后的写入全部跳过，结束时返回 -1
+//   - HTTP 响应：缓冲区写满就作为一个 chunk 发出；整个响应装得下时改为一次性发送（带 Content-Length）
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t len;
+    httpd_req_t *req;       // NULL 表示固定缓冲区
+    bool chunked;           // 已经以 chunk 形式发出过数据
+    bool error;             // 空间不足、嵌套过深或发送失败
+    bool after_key;         // 刚写完键，下一个值前不加逗号
+    uint8_t depth;
+    uint8_t has_member;     // 按层记录当前容器是否已有成员（第 0 层为顶层）
+} json_writer_t;
+
+void json_writer_init_buf(json_writer_t *w, char *buf, size_t size);
+void json_writer_init_http(json_writer_t *w, httpd_req_t *req, char *buf, size_t size);
+
+// 固定缓冲区：补上结尾 '\0'，返回长度（不含 '\0'），出错返回 -1
+int json_writer_finish(json_writer_t *w);
+
+// HTTP 响应：发出剩余内容并结束响应；出错时若还没发出任何数据则回 500
+esp_err_t json_writer_send(json_writer_t *w);
+
+void json_obj_begin(json_writer_t *w);
+void json_obj_end(json_writer_t *w);
+void json_arr_begin(json_writer_t *w);
+void json_arr_end(json_writer_t *w);
+
+// 对象成员的键（键名视为安全字面量，不做转义）
+void json_key(json_writer_t *w, const char *key);
+
+void json_str(json_writer_t *w, const char *s);
+void json_int(json_writer_t *w, int64_t v);
+void json_uint(json_writer_t *w, uint64_t v);
+void json_bool(json_writer_t *w, bool v);
+void json_null(json_writer_t *w);
+
+// 定点小数：value 为放大 10^decimals 后的整数，如 (253, 1) 输出 25.3，decimals 最大 6
+void json_fixed(json_writer_t *w, int32_t value, uint8_t decimals);
+// 同上但带引号，兼容前端按字符串读取的温湿度字段
+void json_fixed_str(json_writer_t *w, int32_t value, uint8_t decimals);
+
+// 原样写入一个已是合法 JSON 的值
+void json_raw(json_writer_t *w, const char *json);
+
+// 键值对简写
+void json_kv_str(json_writer_t *w, const char *key, const char *s);
+void json_kv_int(json_writer_t *w, const char *key, int64_t v);
+void json_kv_uint(json_writer_t *w, const char *key, uint64_t v);
+void json_kv_bool(json_writer_t *w, const char *key, bool v);
+void json_kv_fixed(json_writer_t *w, const char *key, int32_t value, uint8_t decimals);
+void json_kv_fixed_str(json_writer_t *w, const char *key, int32_t value, uint8_t decimals);
+
+// 浮点数换算为定点整数（四舍五入），供只提供 float 的数据源使用
+int32_t json_float_to_fixed(float v, uint8_t decimals);
+
+#endif // JSON_WRITER_H
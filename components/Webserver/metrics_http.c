@@ -0,0 +1,263 @@
+#include <stdio.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+#if CONFIG_LWIP_STATS
+#include "freertos/FreeRTOS.h"
+#include "lwip/stats.h"
+#endif
+#include "metrics.h"
+#include "web_async.h"
+#include "web_session.h"
+#include "web_limit.h"
+#include "ws_push.h"
+#include "metrics_http.h"
+
+// 输出缓冲：攒满后作为一个 chunk 发出；处理函数运行在 httpd 任务中，放静态区避免占用任务栈
+static char s_out[1024];
+static int s_out_len = 0;
+static httpd_req_t *s_req = NULL;
+// 某个 chunk 发送失败（客户端已断开）后不再继续输出
+static esp_err_t s_out_err = ESP_OK;
+
+static void out_flush(void)
+{
+    if (s_out_len > 0 && s_out_err == ESP_OK) {
+        s_out_err = httpd_resp_send_chunk(s_req, s_out, s_out_len);
+    }
+    s_out_len = 0;
+}
+
+// 追加一行，放不下时先把已有内容发出去
+static void out_printf(const char *fmt, ...)
+{
+    if (s_out_err != ESP_OK) {
+        return;
+    }
+    for (int attempt = 0; attempt < 2; attempt++) {
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(s_out + s_out_len, sizeof(s_out) - s_out_len, fmt, ap);
+        va_end(ap);
+        if (n >= 0 && n < (int)sizeof(s_out) - s_out_len) {
+            s_out_len += n;
+            return;
+        }
+        out_flush();
+    }
+}
+
+static void out_header(const char *name, const char *type, const char *help)
+{
+    out_printf("# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+// 输出一个直方图样本组（各档累计），labels 形如 uri="/x"，可为空
+static void out_hist(const char *name, const char *labels, const metrics_hist_t *h)
+{
+    uint32_t counts[METRICS_HIST_BUCKETS];
+    uint64_t sum_us;
+    uint32_t total = metrics_hist_read(h, counts, &sum_us);
+    const char *sep = labels[0] ? "," : "";
+
+    uint32_t cumulative = 0;
+    for (int b = 0; b < METRICS_HIST_BUCKETS - 1; b++) {
+        cumulative += counts[b];
+        out_printf("%s_bucket{%s%sle=\"%lu.%06lu\"} %lu\n", name, labels, sep,
+                   (unsigned long)(metrics_hist_bounds_us[b] / 1000000),
+                   (unsigned long)(metrics_hist_bounds_us[b] % 1000000), (unsigned long)cumulative);
+    }
+    out_printf("%s_bucket{%s%sle=\"+Inf\"} %lu\n", name, labels, sep, (unsigned long)total);
+    const char *open = labels[0] ? "{" : "";
+    const char *close = labels[0] ? "}" : "";
+    out_printf("%s_sum%s%s%s %llu.%06llu\n", name, open, labels, close,
+               (unsigned long long)(sum_us / 1000000), (unsigned long long)(sum_us % 1000000));
+    out_printf("%s_count%s%s%s %lu\n", name, open, labels, close, (unsigned long)total);
+}
+
+// 一个堆指标：内部 RAM 与 PSRAM 各一个样本
+static void out_heap(const char *name, const char *help, size_t (*get)(uint32_t caps))
+{
+    out_header(name, "gauge", help);
+    out_printf("%s{region=\"internal\"} %u\n", name, (unsigned)get(MALLOC_CAP_INTERNAL));
+    out_printf("%s{region=\"psram\"} %u\n", name, (unsigned)get(MALLOC_CAP_SPIRAM));
+}
+
+#if CONFIG_LWIP_STATS
+// lwIP 的 UDP 统计是 16 位计数（未开启 LWIP_STATS_LARGE），几分钟的 mDNS 流量就会回绕，
+// 不符合 Prometheus 计数器只增不减的语义；定时把增量累加进 32 位计数，间隔内远不到 65536 个包
+#define METRICS_UDP_POLL_US (10 * 1000 * 1000)
+
+typedef struct {
+    uint16_t last;
+    uint32_t total;
+} udp_counter_t;
+
+static udp_counter_t s_udp_recv;
+static udp_counter_t s_udp_xmit;
+static portMUX_TYPE s_udp_lock = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t s_udp_timer = NULL;
+
+static void udp_counter_update(udp_counter_t *c, uint16_t now)
+{
+    c->total += (uint16_t)(now - c->last);
+    c->last = now;
+}
+
+// 定时器回调与 /metrics 导出都会调用
+static void udp_counters_poll(void *arg)
+{
+    portENTER_CRITICAL(&s_udp_lock);
+    udp_counter_update(&s_udp_recv, lwip_stats.udp.recv);
+    udp_counter_update(&s_udp_xmit, lwip_stats.udp.xmit);
+    portEXIT_CRITICAL(&s_udp_lock);
+}
+#endif
+
+void metrics_http_start(void)
+{
+#if CONFIG_LWIP_STATS
+    if (s_udp_timer == NULL) {
+        udp_counters_poll(NULL);
+        const esp_timer_create_args_t args = {
+            .callback = udp_counters_poll,
+            .name = "udp_stats",
+        };
+        if (esp_timer_create(&args, &s_udp_timer) == ESP_OK) {
+            esp_timer_start_periodic(s_udp_timer, METRICS_UDP_POLL_US);
+        }
+    }
+#endif
+}
+
+esp_err_t metrics_http_handler(httpd_req_t *req)
+{
+    s_req = req;
+    s_out_len = 0;
+    s_out_err = ESP_OK;
+    httpd_resp_set_type(req, "text/plain; version=0.0.4");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+
+    out_header("home_uptime_seconds", "gauge", "Seconds since boot");
+    out_printf("home_uptime_seconds %llu\n", (unsigned long long)(esp_timer_get_time() / 1000000));
+
+    // 全局计数器与直方图
+    for (int i = 0; i < METRIC_COUNTER_COUNT; i++) {
+        char name[64];
+        snprintf(name, sizeof(name), "%s_total", metrics_counter_name(i));
+        out_header(name, "counter", metrics_counter_help(i));
+        out_printf("%s %lu\n", name, (unsigned long)metrics_counter_value(&g_metrics_counters[i]));
+    }
+    for (int i = 0; i < METRIC_HIST_COUNT; i++) {
+        out_header(metrics_hist_name(i), "histogram", metrics_hist_help(i));
+        out_hist(metrics_hist_name(i), "", &g_metrics_hists[i]);
+    }
+
+    // 各 HTTP 接口
+    int routes = web_route_count();
+    out_header("home_http_request_duration_seconds", "histogram", "HTTP handler latency per URI");
+    for (int i = 0; i < routes; i++) {
+        const web_route_t *route = web_route_at(i);
+        char labels[64];
+        snprintf(labels, sizeof(labels), "uri=\"%s\"", route->uri);
+        out_hist("home_http_request_duration_seconds", labels, &route->stats.latency);
+    }
+    out_header("home_http_queue_wait_seconds", "histogram", "Queue wait of async HTTP handlers per URI");
+    for (int i = 0; i < routes; i++) {
+        const web_route_t *route = web_route_at(i);
+        if (route->async) {
+            char labels[64];
+            snprintf(labels, sizeof(labels), "uri=\"%s\"", route->uri);
+            out_hist("home_http_queue_wait_seconds", labels, &route->stats.wait);
+        }
+    }
+    out_header("home_http_handler_errors_total", "counter", "HTTP handlers that returned an error per URI");
+    for (int i = 0; i < routes; i++) {
+        const web_route_t *route = web_route_at(i);
+        out_printf("home_http_handler_errors_total{uri=\"%s\"} %lu\n", route->uri,
+                   (unsigned long)metrics_counter_value(&route->stats.errors));
+    }
+    out_header("home_http_rejected_total", "counter", "Async HTTP requests rejected with 503 per URI");
+    for (int i = 0; i < routes; i++) {
+        const web_route_t *route = web_route_at(i);
+        if (route->async) {
+            out_printf("home_http_rejected_total{uri=\"%s\"} %lu\n", route->uri,
+                       (unsigned long)metrics_counter_value(&route->stats.rejected));
+        }
+    }
+#if WEB_ALLOC_CHECK
+    out_header("home_http_allocs_total", "counter", "Heap allocations made while handling requests per URI");
+    for (int i = 0; i < routes; i++) {
+        const web_route_t *route = web_route_at(i);
+        out_printf("home_http_allocs_total{uri=\"%s\"} %lu\n", route->uri,
+                   (unsigned long)metrics_counter_value(&route->stats.allocs));
+    }
+#endif
+
+    // WebSocket 发送队列积压（只列出当前连接）
+    ws_push_queue_info_t q;
+    out_header("home_ws_queue_frames", "gauge", "Frames waiting in the WebSocket send queue per socket");
+    for (int i = 0; i < WS_PUSH_MAX_CLIENTS; i++) {
+        if (ws_push_queue_info(i, &q)) {
+            out_printf("home_ws_queue_frames{fd=\"%d\"} %u\n", q.fd, (unsigned)q.frames);
+        }
+    }
+    out_header("home_ws_queue_bytes", "gauge", "Bytes waiting in the WebSocket send queue per socket");
+    for (int i = 0; i < WS_PUSH_MAX_CLIENTS; i++) {
+        if (ws_push_queue_info(i, &q)) {
+            out_printf("home_ws_queue_bytes{fd=\"%d\"} %u\n", q.fd, (unsigned)q.bytes);
+        }
+    }
+
+    // 按来源 IP 的请求与限流计数（只含当前跟踪表中的来源）
+    static const struct {
+        const char *name;
+        const char *help;
+        size_t offset;
+    } client_metrics[] = {
+        { "home_client_requests_total", "HTTP requests admitted per client IP",
+          offsetof(web_limit_client_info_t, requests) },
+        { "home_client_throttled_total", "HTTP requests answered with 429 per client IP",
+          offsetof(web_limit_client_info_t, throttled) },
+        { "home_client_connections_total", "Connections admitted per client IP",
+          offsetof(web_limit_client_info_t, conns) },
+        { "home_client_connections_rejected_total", "Connections closed by the rate limit per client IP",
+          offsetof(web_limit_client_info_t, conns_rejected) },
+    };
+    for (size_t m = 0; m < sizeof(client_metrics) / sizeof(client_metrics[0]); m++) {
+        out_header(client_metrics[m].name, "counter", client_metrics[m].help);
+        web_limit_client_info_t info;
+        for (int i = 0; i < WEB_LIMIT_MAX_CLIENTS; i++) {
+            if (web_limit_client_at(i, &info)) {
+                out_printf("%s{ip=\"%s\"} %lu\n", client_metrics[m].name, info.ip,
+                           (unsigned long)*(const uint32_t *)((const char *)&info + client_metrics[m].offset));
+            }
+        }
+    }
+
+    // 堆：内部 RAM 与 PSRAM 分开统计
+    out_heap("home_heap_free_bytes", "Free heap bytes", heap_caps_get_free_size);
+    out_heap("home_heap_largest_free_block_bytes", "Largest free heap block", heap_caps_get_largest_free_block);
+    out_heap("home_heap_minimum_free_bytes", "Lowest free heap since boot", heap_caps_get_minimum_free_size);
+
+#if CONFIG_LWIP_STATS
+    // mDNS 组件没有对外的收发计数，用 lwIP 的 UDP 统计代替（还包含 DHCP、DNS、SNTP 等少量流量）
+    udp_counters_poll(NULL);
+    portENTER_CRITICAL(&s_udp_lock);
+    uint32_t udp_recv = s_udp_recv.total;
+    uint32_t udp_xmit = s_udp_xmit.total;
+    portEXIT_CRITICAL(&s_udp_lock);
+    out_header("home_udp_packets_received_total", "counter", "UDP datagrams received (mostly mDNS)");
+    out_printf("home_udp_packets_received_total %lu\n", (unsigned long)udp_recv);
+    out_header("home_udp_packets_sent_total", "counter", "UDP datagrams sent (mostly mDNS)");
+    out_printf("home_udp_packets_sent_total %lu\n", (unsigned long)udp_xmit);
+#endif
+
+    out_flush();
+    if (s_out_err != ESP_OK) {
+        return s_out_err;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
@@ -0,0 +1,14 @@
+#ifndef METRICS_HTTP_H
+#define METRICS_HTTP_H
+
+#include "esp_http_server.h"
+
+// GET /metrics：Prometheus 文本格式，逐段 chunked 发送，不整体拼接
+// 包括各接口耗时直方图、WebSocket/SSE 帧数、传感器读取结果与耗时、NVS 提交次数、
+// 内部 RAM 与 PSRAM 的空闲/最大块，以及 UDP 收发包数（mDNS 是主要的 UDP 流量）
+esp_err_t metrics_http_handler(httpd_req_t *req);
+
+// 启动 UDP 统计的定时累加（lwIP 的 16 位计数转成 32 位），启动 Web 服务时调用一次
+void metrics_http_start(void);
+
+#endif // METRICS_HTTP_H
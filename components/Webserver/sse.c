@@ -0,0 +1,377 @@
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "data_process.h"
+#include "settings.h"
+#include "data_json.h"
+#include "json_writer.h"
+#include "sse.h"
+#include "ws_push.h"
+#include "web_sendq.h"
+#include "metrics.h"
+
+static const char *TAG = "SSE";
+
+// 每次从样本缓冲取出的条数
+#define SSE_REPLAY_BATCH 16
+// chunk 头（十六进制长度 + CRLF）与结尾 CRLF
+#define SSE_CHUNK_OVERHEAD 8
+
+// 单个 SSE 连接的状态
+typedef struct {
+    httpd_req_t *req;       // 异步请求副本，NULL 表示空位
+    int fd;
+    uint32_t sample_seq;    // 已发给该连接的最后一个采样序号
+    uint32_t history_gen;   // 该连接已知的历史版本
+    int32_t alarm_x10;      // 该连接已知的报警阈值
+    bool alarm_active;      // 该连接已知的超温状态
+    bool snap_pending;      // 补发追上当前序号后再发快照
+    web_sendq_t q;          // 发送队列，与 WebSocket 客户端相同：非阻塞写出，卡住太久即断开
+} sse_client_t;
+
+// 连接表与发送缓冲只在 httpd 任务中访问（处理函数、广播与重试工作、close_fn），不需要加锁
+static sse_client_t s_clients[SSE_MAX_CLIENTS];
+static char s_buf[DATA_JSON_BUF_SIZE + 256];
+static int s_len = 0;
+// 各连接的发送队列缓冲，启动时一次性分配
+static uint8_t *s_queue_pool = NULL;
+
+// 追加格式化内容到发送缓冲，空间不足时置 -1
+#define SSE_APPEND(...) do { \
+    if (s_len >= 0) { \
+        int _n = snprintf(s_buf + s_len, sizeof(s_buf) - s_len, __VA_ARGS__); \
+        s_len = (_n < 0 || (size_t)_n >= sizeof(s_buf) - s_len) ? -1 : s_len + _n; \
+    } \
+} while (0)
+
+static int32_t current_temp_x10(void)
+{
+    return get_temperature_int() * 10 + get_temperature_dec();
+}
+
+// 释放连接：结束异步请求并关闭 socket
+static void sse_drop(sse_client_t *c)
+{
+    httpd_req_t *req = c->req;
+    httpd_handle_t hd = req->handle;
+    int fd = c->fd;
+    c->req = NULL;
+    httpd_req_async_handler_complete(req);
+    httpd_sess_trigger_close(hd, fd);
+}
+
+// 尽量写出发送队列，写不完的留给定时重试；出错或积压太久视为断线
+static esp_err_t sse_drain_client(sse_client_t *c, int64_t now)
+{
+    uint32_t frames = 0;
+    esp_err_t ret = web_sendq_drain(&c->q, c->req->handle, c->fd, now, &frames, NULL);
+    METRICS_ADD(METRIC_SSE_EVENTS_SENT, frames);
+    if (ret == ESP_ERR_TIMEOUT) {
+        ESP_LOGW(TAG, "SSE 连接 fd=%d 发送积压超过 %d ms，断开", c->fd, WEB_SENDQ_STALL_MS);
+    } else if (ret != ESP_OK) {
+        ESP_LOGI(TAG, "SSE 连接 fd=%d 已断开", c->fd);
+    }
+    if (ret != ESP_OK) {
+        sse_drop(c);
+        return ret;
+    }
+    if (c->q.count > 0) {
+        ws_push_schedule_drain();
+    }
+    return ESP_OK;
+}
+
+// 把发送缓冲作为一个 chunk 放进该连接的发送队列并尽量写出；
+// 队列放不下说明客户端落后太多，与写出失败一样断开它
+static esp_err_t sse_flush(sse_client_t *c, uint8_t kind)
+{
+    if (s_len < 0) {
+        ESP_LOGE(TAG, "事件超出缓冲区");
+        s_len = 0;
+        return ESP_FAIL;
+    }
+    if (s_len == 0) {
+        return ESP_OK;
+    }
+    char head[SSE_CHUNK_OVERHEAD];
+    int head_len = snprintf(head, sizeof(head), "%x\r\n", s_len);
+    esp_err_t ret = web_sendq_push(&c->q, head, head_len, s_buf, s_len, "\r\n", 2, kind);
+    s_len = 0;
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "SSE 连接 fd=%d 发送队列已满，断开", c->fd);
+        sse_drop(c);
+        return ret;
+    }
+    return sse_drain_client(c, esp_timer_get_time());
+}
+
+// 在发送缓冲末尾开始写一个 data: 行的 JSON 值
+static void sse_json_begin(json_writer_t *w)
+{
+    SSE_APPEND("data: ");
+    if (s_len >= 0) {
+        json_writer_init_buf(w, s_buf + s_len, sizeof(s_buf) - s_len);
+    } else {
+        json_writer_init_buf(w, NULL, 0);
+    }
+}
+
+// 结束 JSON 值与整个事件
+static void sse_json_end(json_writer_t *w)
+{
+    int n = json_writer_finish(w);
+    if (s_len >= 0) {
+        s_len = n < 0 ? -1 : s_len + n;
+    }
+    SSE_APPEND("\n\n");
+}
+
+// 事件 id 为续传令牌（启动 ID-采样序号），设备重启后旧 id 不会被当成新序号续传
+static void sse_append_sample(const sample_record_t *r)
+{
+    json_writer_t w;
+    char boot[9];
+    data_json_boot_str(boot, sizeof(boot));
+    SSE_APPEND("id: %s-%lu\nevent: sample\n", boot, (unsigned long)r->seq);
+    sse_json_begin(&w);
+    json_obj_begin(&w);
+    json_kv_uint(&w, "seq", r->seq);
+    json_kv_uint(&w, "ts", r->ts);
+    json_kv_fixed_str(&w, "temperature", r->temp_x10, 1);
+    json_kv_fixed_str(&w, "humidity", r->hum_x10, 1);
+    json_obj_end(&w);
+    sse_json_end(&w);
+}
+
+// 补发该连接已知序号之后的样本：分批取出，每批一个 chunk 放进发送队列；
+// 队列放不下下一批时先停下，等队列腾出空间后由定时重试接着补发，不一次灌满队列。
+// 已追上当前序号返回 true
+static bool sse_replay(sse_client_t *c)
+{
+    sample_record_t recs[SSE_REPLAY_BATCH];
+    while (c->req != NULL && get_sample_seq() != c->sample_seq) {
+        if (!web_sendq_room(&c->q, sizeof(s_buf) + SSE_CHUNK_OVERHEAD)) {
+            return false;
+        }
+        uint32_t oldest;
+        int n = get_samples_since(c->sample_seq, recs, SSE_REPLAY_BATCH, &oldest);
+        if (n == 0) {
+            // 样本缓冲不可用（分配失败）时退化为只发当前读数，留在缓冲里随后续事件一起发出
+            uint32_t current = get_sample_seq();
+            if (oldest == 0 && current != c->sample_seq) {
+                sample_record_t r = {
+                    .seq = current,
+                    .ts = (uint32_t)time(NULL),
+                    .temp_x10 = (int16_t)current_temp_x10(),
+                    .hum_x10 = (uint16_t)(get_humidity_int() * 10 + get_humidity_dec()),
+                };
+                sse_append_sample(&r);
+                c->sample_seq = current;
+            }
+            return true;
+        }
+        for (int i = 0; i < n; i++) {
+            sse_append_sample(&recs[i]);
+        }
+        c->sample_seq = recs[n - 1].seq;
+        sse_flush(c, WEB_SENDQ_EVENT);
+    }
+    return c->req != NULL;
+}
+
+// 快照：完整数据，id 为当前续传令牌，客户端每次（重）连接都会收到
+static void sse_append_snap(sse_client_t *c, const char *resume_state)
+{
+    json_writer_t w;
+    char boot[9];
+    data_json_boot_str(boot, sizeof(boot));
+    SSE_APPEND("id: %s-%lu\nevent: snap\n", boot, (unsigned long)c->sample_seq);
+    sse_json_begin(&w);
+    json_obj_begin(&w);
+    data_json_fields(&w, DATA_JSON_ALL);
+    json_kv_str(&w, "boot", boot);
+    json_kv_uint(&w, "seq", c->sample_seq);
+    if (resume_state != NULL) {
+        json_kv_str(&w, "resume", resume_state);
+    }
+    json_obj_end(&w);
+    sse_json_end(&w);
+    c->history_gen = get_history_gen();
+    c->alarm_x10 = settings_get_alarm_x10();
+    c->alarm_active = current_temp_x10() > c->alarm_x10;
+}
+
+// 把连接的已知状态推进到当前，只发送变化的事件；tick 为广播节拍，没有事件时发一行注释作为心跳。
+// 补发还没追上时只继续补发，快照与其他事件等追上后再发
+static void sse_update(sse_client_t *c, bool tick)
+{
+    if (!sse_replay(c)) {
+        return;
+    }
+
+    if (c->snap_pending) {
+        sse_append_snap(c, "ok");
+        c->snap_pending = false;
+    }
+
+    int32_t alarm = settings_get_alarm_x10();
+    bool active = current_temp_x10() > alarm;
+    if (alarm != c->alarm_x10 || active != c->alarm_active) {
+        json_writer_t w;
+        SSE_APPEND("event: alarm\n");
+        sse_json_begin(&w);
+        json_obj_begin(&w);
+        json_kv_bool(&w, "active", active);
+        json_kv_fixed_str(&w, "alarmThreshold", alarm, 1);
+        json_obj_end(&w);
+        sse_json_end(&w);
+        c->alarm_x10 = alarm;
+        c->alarm_active = active;
+    }
+
+    uint32_t history = get_history_gen();
+    if (history != c->history_gen) {
+        json_writer_t w;
+        SSE_APPEND("event: rollover\n");
+        sse_json_begin(&w);
+        json_obj_begin(&w);
+        data_json_fields(&w, DATA_JSON_TODAY | DATA_JSON_HISTORY);
+        json_obj_end(&w);
+        sse_json_end(&w);
+        c->history_gen = history;
+    }
+
+    // 心跳可被取代：队列里还压着上一条心跳时不再多发一条
+    uint8_t kind = WEB_SENDQ_EVENT;
+    if (s_len == 0 && tick) {
+        SSE_APPEND(": ping\n\n");
+        kind = WEB_SENDQ_DIAG;
+        web_sendq_drop(&c->q, WEB_SENDQ_DIAG);
+    }
+    sse_flush(c, kind);
+}
+
+void sse_broadcast(void)
+{
+    for (int i = 0; i < SSE_MAX_CLIENTS; i++) {
+        if (s_clients[i].req != NULL) {
+            sse_update(&s_clients[i], true);
+        }
+    }
+}
+
+bool sse_drain(int64_t now)
+{
+    bool pending = false;
+    for (int i = 0; i < SSE_MAX_CLIENTS; i++) {
+        sse_client_t *c = &s_clients[i];
+        if (c->req == NULL) {
+            continue;
+        }
+        if (c->q.count > 0 && sse_drain_client(c, now) != ESP_OK) {
+            continue;
+        }
+        // 队列腾出空间后接着补发（续传中的连接追上后再发快照）
+        if (c->snap_pending || get_sample_seq() != c->sample_seq) {
+            sse_update(c, false);
+        }
+        pending |= c->req != NULL && c->q.count > 0;
+    }
+    return pending;
+}
+
+void sse_start(void)
+{
+    if (s_queue_pool == NULL) {
+        s_queue_pool = web_sendq_alloc_pool(SSE_MAX_CLIENTS);
+        if (s_queue_pool == NULL) {
+            ESP_LOGE(TAG, "发送队列分配失败，SSE 不可用");
+        }
+    }
+}
+
+void sse_remove_client(int fd)
+{
+    for (int i = 0; i < SSE_MAX_CLIENTS; i++) {
+        if (s_clients[i].req != NULL && s_clients[i].fd == fd) {
+            // socket 正在由 httpd 关闭，这里只结束异步请求
+            httpd_req_t *req = s_clients[i].req;
+            s_clients[i].req = NULL;
+            httpd_req_async_handler_complete(req);
+        }
+    }
+}
+
+esp_err_t sse_handler(httpd_req_t *req)
+{
+    sse_client_t *c = NULL;
+    for (int i = 0; i < SSE_MAX_CLIENTS; i++) {
+        if (s_clients[i].req == NULL) {
+            c = &s_clients[i];
+            break;
+        }
+    }
+    if (c == NULL || s_queue_pool == NULL) {
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_set_hdr(req, "Retry-After", "10");
+        return httpd_resp_sendstr(req, "too many event streams");
+    }
+
+    // 浏览器重连时自动带上最后收到的事件 id（续传令牌），启动 ID 不符时按缺口处理
+    bool resume = false;
+    bool resume_valid = false;
+    uint32_t last_id = 0;
+    char id_str[DATA_JSON_TOKEN_LEN];
+    if (httpd_req_get_hdr_value_str(req, "Last-Event-ID", id_str, sizeof(id_str)) == ESP_OK) {
+        resume = true;
+        resume_valid = data_json_parse_token(id_str, &last_id);
+    }
+
+    // 复制请求，处理函数返回后 socket 仍然保持打开，由广播持续写入
+    httpd_req_t *copy = NULL;
+    if (httpd_req_async_handler_begin(req, &copy) != ESP_OK) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+    memset(c, 0, sizeof(*c));
+    c->req = copy;
+    c->fd = httpd_req_to_sockfd(req);
+    web_sendq_reset(&c->q, s_queue_pool + (c - s_clients) * WEB_SENDQ_BYTES);
+
+    httpd_resp_set_type(copy, "text/event-stream");
+    httpd_resp_set_hdr(copy, "Cache-Control", "no-cache");
+
+    // 能否续传：序号在当前序号之前，且缺口仍在样本缓冲和补发上限之内
+    uint32_t current = get_sample_seq();
+    uint32_t oldest = 0;
+    get_samples_since(current, NULL, 0, &oldest);
+    const char *resume_state = "none";
+    if (resume) {
+        bool in_range = resume_valid &&
+                        (int32_t)(current - last_id) >= 0 &&
+                        current - last_id <= SSE_MAX_REPLAY &&
+                        oldest != 0 && (int32_t)(last_id + 1 - oldest) >= 0;
+        resume_state = in_range ? "ok" : "gap";
+        resume = in_range;
+    }
+    ESP_LOGI(TAG, "SSE 连接建立 fd=%d (续传: %s)", c->fd, resume_state);
+
+    // 响应头与第一行由 httpd 直接发出：连接刚建立，发送缓冲是空的，不会阻塞；
+    // 之后的事件都经发送队列非阻塞写出
+    if (httpd_resp_sendstr_chunk(copy, "retry: 3000\n\n") != ESP_OK) {
+        sse_drop(c);
+        return ESP_OK;
+    }
+    if (resume) {
+        // 补发按队列空间分批进行，追上当前序号后再发快照
+        c->sample_seq = last_id;
+        c->snap_pending = true;
+        sse_update(c, false);
+        return ESP_OK;
+    }
+    c->sample_seq = current;
+    sse_append_snap(c, resume_state);
+    sse_flush(c, WEB_SENDQ_EVENT);
+    return ESP_OK;
+}
@@ -0,0 +1,34 @@
+#ifndef SSE_H
+#define SSE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_http_server.h"
+
+// 同时保持的 SSE 连接上限：每个连接常驻占用一个 socket
+#define SSE_MAX_CLIENTS 3
+
+// 断线续传最多补发的样本数（约 10 分钟），缺口更大时直接发快照
+#define SSE_MAX_REPLAY  300
+
+// GET /events：text/event-stream 推送通道
+// 事件：snap（连接时的完整数据）、sample（每次采样，id 为续传令牌"启动 ID-采样序号"）、
+//       alarm（超温状态或阈值变化）、rollover（跨天，今日极值与历史已更新）
+// 重连时浏览器自动带上 Last-Event-ID，服务端从样本缓冲补发错过的 sample；
+// 启动 ID 与本次启动不符（设备重启过）时不补发，snap 中 resume 为 gap
+esp_err_t sse_handler(httpd_req_t *req);
+
+// 分配各连接的发送队列，在 httpd 启动后调用
+void sse_start(void);
+
+// 在 WebSocket 广播时一并调用（httpd 任务中），向所有 SSE 连接推送新事件
+void sse_broadcast(void);
+
+// 由 WebSocket 的定时重试一并调用（httpd 任务中）：续写积压的事件并继续未完成的补发，
+// 仍有积压返回 true。SSE 与 WebSocket 共用同一套发送队列与卡死断开的期限（web_sendq.h）
+bool sse_drain(int64_t now);
+
+// 会话关闭时释放对应的 SSE 连接（在 httpd 的 close_fn 中调用）
+void sse_remove_client(int fd);
+
+#endif // SSE_H
@@ -0,0 +1,271 @@
+#!/usr/bin/env python3
+# 构建期网页资源处理：扫描 www/ 目录，压缩（最小化 + gzip，可选 brotli）、计算内容哈希，
+# 生成 web_assets_data.c：资源表（路径、MIME、缓存策略、ETag、各编码的指针和长度）
+# 以及构建期求出的完美哈希槽位表，运行时一次哈希即可定位资源。
+#
+# 用法: gen_web_assets.py --www <目录> --out web_assets_data.c
+# 输入文件如以 .gz 结尾则先解压，访问路径去掉 .gz 后缀。
+import argparse
+import gzip
+import hashlib
+import io
+import os
+import re
+import sys
+import zlib
+
+try:
+    import brotli  # 可选依赖，没有安装时不生成 br 版本
+except ImportError:
+    brotli = None
+
+MIME_TYPES = {
+    '.html': 'text/html',
+    '.js': 'application/javascript',
+    '.css': 'text/css',
+    '.json': 'application/json',
+    '.svg': 'image/svg+xml',
+    '.png': 'image/png',
+    '.jpg': 'image/jpeg',
+    '.ico': 'image/x-icon',
+    '.woff2': 'font/woff2',
+    '.txt': 'text/plain',
+}
+
+# 已经是压缩格式的资源再 gzip 收益很小，只保留原文
+PRECOMPRESSED = ('.png', '.jpg', '.woff2')
+
+# 页面状态占位符，与 web_assets.h 中的 WEB_ASSET_STATE_MARK 一致
+STATE_MARK = b'/*@STATE@*/null'
+
+CACHE_IMMUTABLE = 'WEB_ASSET_CACHE_IMMUTABLE'
+CACHE_REVALIDATE = 'WEB_ASSET_CACHE_REVALIDATE'
+
+
+def minify_html(text):
+    # 只做保守的压缩：去掉 HTML 注释、整行的 // 与 /* */ 注释、行首尾空白和空行。
+    # 保留换行，因此不会改变脚本里依赖换行的语义。
+    text = re.sub(r'<!--.*?-->', '', text, flags=re.S)
+    out = []
+    for line in text.splitlines():
+        line = line.strip()
+        if not line or line.startswith('//'):
+            continue
+        if line.startswith('/*') and line.endswith('*/'):
+            continue
+        out.append(line)
+    return '\n'.join(out) + '\n'
+
+
+def gzip_bytes(data):
+    buf = io.BytesIO()
+    # mtime=0 保证同样的输入得到同样的输出，构建可复现
+    with gzip.GzipFile(fileobj=buf, mode='wb', compresslevel=9, mtime=0) as f:
+        f.write(data)
+    return buf.getvalue()
+
+
+def crc32_multmodp(a, b):
+    # GF(2) 上 a * b mod P（CRC-32 反射表示），与 web_assets.c 中的 crc32_multmodp() 一致
+    m = 1 << 31
+    p = 0
+    while True:
+        if a & m:
+            p ^= b
+            if (a & (m - 1)) == 0:
+                break
+        m >>= 1
+        b = (b >> 1) ^ 0xedb88320 if b & 1 else b >> 1
+    return p
+
+
+def crc32_shift(n):
+    # x^(8n) mod P：已知 A 的 CRC 时，crc(A + B) = multmodp(shift(len(B)), crc(A)) ^ crc(B)
+    result = 1 << 31
+    base = 1 << 23
+    while n:
+        if n & 1:
+            result = crc32_multmodp(base, result)
+        base = crc32_multmodp(base, base)
+        n >>= 1
+    return result
+
+
+def split_gzip(head, tail):
+    # 带状态的页面按占位符切成两段分别压缩，运行时把状态作为 deflate 不压缩块插在中间：
+    # 前段 = gzip 头 + deflate 数据，以 full flush 结束（按字节对齐、不引用之前的数据）；
+    # 后段 = 独立的 deflate 数据（含结束块），gzip 尾部（CRC32 与长度）由运行时补上
+    c = zlib.compressobj(9, zlib.DEFLATED, -15)
+    gz_head = b'\x1f\x8b\x08\x00\x00\x00\x00\x00\x02\xff' + c.compress(head) + c.flush(zlib.Z_FULL_FLUSH)
+    c = zlib.compressobj(9, zlib.DEFLATED, -15)
+    gz_tail = c.compress(tail) + c.flush(zlib.Z_FINISH)
+    return gz_head, gz_tail
+
+
+def path_hash(path, seed):
+    # 与 web_assets.c 中的 web_asset_hash() 保持一致：带种子的 FNV-1a + 末尾混合
+    h = (2166136261 ^ seed) & 0xffffffff
+    for b in path.encode('utf-8'):
+        h ^= b
+        h = (h * 16777619) & 0xffffffff
+    h ^= h >> 15
+    h = (h * 0x2c1b3c6d) & 0xffffffff
+    h ^= h >> 12
+    return h
+
+
+def find_perfect_hash(paths):
+    slots = 4
+    while slots < len(paths) * 2:
+        slots *= 2
+    while True:
+        for seed in range(1, 200000):
+            used = set()
+            for p in paths:
+                idx = path_hash(p, seed) & (slots - 1)
+                if idx in used:
+                    break
+                used.add(idx)
+            else:
+                return seed, slots
+        slots *= 2
+
+
+def c_ident(name):
+    return re.sub(r'[^0-9a-zA-Z]', '_', name.strip('/'))
+
+
+def c_array(name, data):
+    lines = ['static const uint8_t %s[%d] = {' % (name, max(len(data), 1))]
+    for i in range(0, len(data), 20):
+        lines.append('    ' + ', '.join('0x%02x' % b for b in data[i:i + 20]) + ',')
+    lines.append('};')
+    return '\n'.join(lines)
+
+
+def load_assets(www):
+    assets = []
+    for root, _, files in os.walk(www):
+        for fname in sorted(files):
+            full = os.path.join(root, fname)
+            with open(full, 'rb') as f:
+                data = f.read()
+            rel = '/' + os.path.relpath(full, www).replace(os.sep, '/')
+            if rel.endswith('.gz'):
+                data = gzip.decompress(data)
+                rel = rel[:-3]
+            ext = os.path.splitext(rel)[1].lower()
+            assets.append({'path': rel, 'data': data, 'ext': ext,
+                           'mime': MIME_TYPES.get(ext, 'application/octet-stream')})
+    assets.sort(key=lambda a: a['path'])
+    return assets
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--www', required=True, help='静态资源目录')
+    parser.add_argument('--out', required=True, help='生成的 C 源文件路径')
+    args = parser.parse_args()
+
+    assets = load_assets(args.www)
+    if len(assets) > 255:
+        sys.exit('too many web assets')
+
+    # 先处理非 HTML 资源拿到哈希，HTML 中对它们的引用改写为带版本号的地址，
+    # 被这样引用的资源可以长期缓存（immutable），内容变了地址也跟着变
+    versions = {}
+    for a in [a for a in assets if a['ext'] != '.html']:
+        a['identity'] = a['data']
+        a['hash'] = hashlib.sha256(a['data']).hexdigest()[:16]
+        versions[a['path']] = a['hash'][:8]
+    referenced = set()
+    for a in [a for a in assets if a['ext'] == '.html']:
+        text = a['data'].decode('utf-8')
+        for ref, ver in versions.items():
+            pattern = r'(src|href)="%s"' % re.escape(ref)
+            if re.search(pattern, text):
+                referenced.add(ref)
+                text = re.sub(pattern, r'\1="%s?v=%s"' % (ref, ver), text)
+        a['identity'] = minify_html(text).encode('utf-8')
+        a['hash'] = hashlib.sha256(a['identity']).hexdigest()[:16]
+
+    for a in assets:
+        compress = a['ext'] not in PRECOMPRESSED
+        a['state_at'] = a['identity'].find(STATE_MARK) if a['ext'] == '.html' else -1
+        if a['state_at'] >= 0:
+            # 带状态的页面每次内容都不同，不生成整页压缩版本，只生成切开的两段 gzip
+            head = a['identity'][:a['state_at']]
+            tail = a['identity'][a['state_at'] + len(STATE_MARK):]
+            a['gzip_head'], a['gzip_tail'] = split_gzip(head, tail)
+            a['crc_head'] = zlib.crc32(head)
+            a['crc_tail'] = zlib.crc32(tail)
+            a['crc_tail_shift'] = crc32_shift(len(tail))
+            compress = False
+        a['gzip'] = gzip_bytes(a['identity']) if compress else None
+        a['br'] = brotli.compress(a['identity'], quality=11) if (compress and brotli) else None
+        a['cache'] = CACHE_IMMUTABLE if a['path'] in referenced else CACHE_REVALIDATE
+
+    seed, slots = find_perfect_hash([a['path'] for a in assets])
+    slot_table = [0xff] * slots
+    for i, a in enumerate(assets):
+        slot_table[path_hash(a['path'], seed) & (slots - 1)] = i
+
+    out = ['// 由 tools/gen_web_assets.py 在构建时生成，请勿手工修改',
+           '#include <stdint.h>',
+           '#include <stddef.h>',
+           '#include "web_assets.h"',
+           '']
+    for a in assets:
+        ident = c_ident(a['path'])
+        out.append(c_array('%s_identity' % ident, a['identity']))
+        for enc in ('gzip', 'br'):
+            if a[enc] is not None:
+                out.append(c_array('%s_%s' % (ident, enc), a[enc]))
+        if a['state_at'] >= 0:
+            out.append(c_array('%s_gzip_head' % ident, a['gzip_head']))
+            out.append(c_array('%s_gzip_tail' % ident, a['gzip_tail']))
+        out.append('')
+
+    out.append('const web_asset_t web_assets[] = {')
+    for a in assets:
+        ident = c_ident(a['path'])
+        out.append('    {')
+        out.append('        .path = "%s",' % a['path'])
+        out.append('        .mime = "%s",' % a['mime'])
+        out.append('        .cache_control = %s,' % a['cache'])
+        out.append('        .hash = "%s",' % a['hash'])
+        out.append('        .identity = %s_identity, .identity_len = %d,' % (ident, len(a['identity'])))
+        for enc in ('gzip', 'br'):
+            if a[enc] is not None:
+                out.append('        .%s = %s_%s, .%s_len = %d,' % (enc, ident, enc, enc, len(a[enc])))
+            else:
+                out.append('        .%s = NULL, .%s_len = 0,' % (enc, enc))
+        if a['state_at'] >= 0:
+            out.append('        .state_at = %d, .state_len = %d,' % (a['state_at'], len(STATE_MARK)))
+            out.append('        .gzip_head = %s_gzip_head, .gzip_head_len = %d,' % (ident, len(a['gzip_head'])))
+            out.append('        .gzip_tail = %s_gzip_tail, .gzip_tail_len = %d,' % (ident, len(a['gzip_tail'])))
+            out.append('        .crc_head = 0x%08xu, .crc_tail = 0x%08xu, .crc_tail_shift = 0x%08xu,' % (
+                a['crc_head'], a['crc_tail'], a['crc_tail_shift']))
+        out.append('    },')
+        if a['state_at'] >= 0:
+            gz = '%d+%d' % (len(a['gzip_head']), len(a['gzip_tail']))
+        else:
+            gz = len(a['gzip']) if a['gzip'] is not None else '-'
+        sys.stdout.write('web asset %-16s identity %7d  gzip %7s  br %7s  hash %s\n' % (
+            a['path'], len(a['identity']), gz,
+            len(a['br']) if a['br'] is not None else '-', a['hash']))
+    out.append('};')
+    out.append('const size_t web_assets_count = %d;' % len(assets))
+    out.append('')
+    out.append('// 完美哈希：web_asset_hash(path, seed) & mask 直接得到资源下标，0xff 为空槽')
+    out.append('const uint32_t web_asset_hash_seed = %du;' % seed)
+    out.append('const uint32_t web_asset_slot_mask = %du;' % (slots - 1))
+    out.append('const uint8_t web_asset_slots[%d] = { %s };' % (slots, ', '.join(str(x) for x in slot_table)))
+    out.append('')
+
+    with open(args.out, 'w') as f:
+        f.write('\n'.join(out))
+
+
+if __name__ == '__main__':
+    main()
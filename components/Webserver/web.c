@@ -1,129 +1,97 @@
 #include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
 #include <esp_http_server.h>
 #include "data_process.h"
-#include "sys/time.h"
-#include "time.h"
 #include "esp_log.h"
-#include "cJSON.h" // 引入 cJSON 库来解析网页发来的账号密码
-#include "esp_wifi.h" // 引入 WiFi 库以应用新的配置
-#include "nvs_flash.h" // 引入 NVS 保存 Wi-Fi 账号密码
-#include "nvs.h"
-#include "ap.h" // 引入 AP 模块获取 NTP 状态
-
-// 定义时间同步标志位在开头
-bool time_sync_done = false;
-
-// 声明全局报警阈值，默认 30.0
-float g_alarm_threshold = 30.0;
+#include "ap.h" // 引入 AP 模块的配网状态回调
+#include "web.h"
+#include "ws_push.h" // WebSocket 主动推送
+#include "data_json.h" // 数据 JSON 生成
+#include "ws_bin.h" // 二进制推送子协议
+#include "diag_bench.h" // 设备端编码基准测试
+#include "api.h" // 带 ETag 的拆分数据接口
+#include "web_assets.h" // 构建时压缩的静态资源
+#include "web_async.h" // 路由表与异步工作线程
+#include "settings.h" // 设置服务（报警阈值）
+#include "sse.h" // Server-Sent Events 推送
+#include "metrics.h" // 运行指标
+#include "metrics_http.h" // Prometheus 指标导出
+#include "trace.h" // 耗时区间追踪
+#include "diag_trace.h" // 追踪导出
+#include "json_writer.h" // 流式 JSON 生成
+#include "web_session.h" // 会话缓冲与请求内存池
+#include "web_limit.h" // 按来源 IP 限流
+#include "web_ctrl.h" // 控制命令（HTTP 与 WebSocket 共用）
+#include "json_reader.h" // 请求体就地解析
 
 //声明一下静态的TAG
 static const char *TAG = "WEBSERVER";
 
-// 嵌入资源（命名由 objcopy 自动生成）
-extern const uint8_t _binary_index_html_start[];
-extern const uint8_t _binary_index_html_end[];
-
-//嵌入 chart.js 库
-extern const uint8_t _binary_chart_js_gz_start[];
-extern const uint8_t _binary_chart_js_gz_end[];
-
-// 处理index.html文件请求
-static esp_err_t index_handler(httpd_req_t *req)
-{
-    // 设置响应类型为text/html
-    httpd_resp_set_type(req, "text/html");
-    // 发送动态 HTML
-    return httpd_resp_send(req, (const char *)_binary_index_html_start, _binary_index_html_end - _binary_index_html_start);
-}
-
-// 提取生成 JSON 数据的通用逻辑，让 HTTP /data 接口和 WebSocket 接口都能复用
-static char* generate_data_json()
-{
-    // 获取实时温湿度数据
-    int temp_int = get_temperature_int();
-    int temp_dec = get_temperature_dec();
-    int hum_int = get_humidity_int();
-    int hum_dec = get_humidity_dec();
-
-    // 获取今日统计数据
-    float max_t_today, min_t_today, max_h_today, min_h_today;
-    get_today_stats(&max_t_today, &min_t_today, &max_h_today, &min_h_today);
-
-    //获取七天历史数据
-    DailyData history[7];
-    get_weekly_history(history);
-
-    // 生成 JSON
-    char *json_response = malloc(2048);
-    if (json_response == NULL) {
-        return NULL;
-    }
-    //今日数据
-    int offset = 0;
-    offset += sprintf(json_response + offset, 
-             "{\"temperature\": \"%d.%d\", \"humidity\": \"%d.%d\", "
-             "\"max_temp_today\": \"%.1f\", \"min_temp_today\": \"%.1f\", "
-             "\"max_hum_today\": \"%.1f\", \"min_hum_today\": \"%.1f\", "
-             "\"alarmThreshold\": \"%.1f\", "
-             "\"history\": [", 
-             temp_int, temp_dec, hum_int, hum_dec, 
-             max_t_today, min_t_today, max_h_today, min_h_today,
-             g_alarm_threshold);
-
-    // 循环写入历史数组
-    for (int i = 0; i < 7; i++) {
-        // 如果数据无效，就填 null 或者 0，前端判断 valid 字段
-        if (history[i].valid) {
-             offset += sprintf(json_response + offset, 
-                "{\"day_ago\": %d, \"weekday\": %d, \"max_temp\": %.1f, \"min_temp\": %.1f, \"max_hum\": %.1f, \"min_hum\": %.1f},", 
-                i + 1, history[i].weekday, history[i].max_temp, history[i].min_temp, history[i].max_hum, history[i].min_hum);
-        } else {
-             // 无效数据传个标志
-             offset += sprintf(json_response + offset, "null,");
-        }
-    }
-    
-    // 去掉最后一个多余的逗号 (如果数组不为空)
-    if (json_response[offset-1] == ',') {
-        offset--;
-    }
-
-    // 闭合数组和 JSON 对象
-    sprintf(json_response + offset, "]}");
-
-    return json_response;
-}
-
 // 处理数据请求，返回 JSON（保留旧的 HTTP 轮询接口，平滑过渡）
 static esp_err_t data_handler(httpd_req_t *req)
 {
     // 设置响应类型为application/json
     httpd_resp_set_type(req, "application/json");
 
-    char* json_response = generate_data_json();
-    if(json_response == NULL) return ESP_FAIL;
-
-    // 发送
-    httpd_resp_send(req, json_response, strlen(json_response));
-    
-    // 释放内存
-    free(json_response);
-    
-    return ESP_OK;   
+    // 边生成边发送，缓冲区满了就作为一个 chunk 发出
+    char buf[512];
+    json_writer_t w;
+    json_writer_init_http(&w, req, buf, sizeof(buf));
+    json_obj_begin(&w);
+    data_json_fields(&w, DATA_JSON_ALL);
+    json_obj_end(&w);
+    return json_writer_send(&w);
 }
 
 // WebSocket 消息处理程序
 static esp_err_t ws_handler(httpd_req_t *req)
 {
     if (req->method == HTTP_GET) {
-        // HTTP 升级到 WebSocket 的初次握手请求
-        ESP_LOGI(TAG, "WebSocket 连接建立");
+        // HTTP 升级到 WebSocket 的初次握手请求，握手完成即订阅服务端推送
+        // 推送协议版本由握手地址指定：/ws?v=2 为增量协议，不带参数为旧版整帧
+        // v2 可在握手时用 topics=live:10,alarm 指定订阅的主题，不带则为默认主题
+        int proto = WS_PROTO_V1;
+        char query[128];
+        char ver[4];
+        // backfill=N 让订阅快照之前先补发一帧最近 N 分钟的样本，图表一次就能画满
+        // resume=<令牌> 为断线重连：补发该样本之后缺失的全部样本，缺口太大或设备重启过时回 gap
+        char topics[64];
+        char backfill[4];
+        char resume[DATA_JSON_TOKEN_LEN];
+        bool has_topics = false;
+        bool has_resume = false;
+        int backfill_min = 0;
+        if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+            if (httpd_query_key_value(query, "v", ver, sizeof(ver)) == ESP_OK) {
+                proto = atoi(ver);
+            }
+            has_topics = httpd_query_key_value(query, "topics", topics, sizeof(topics)) == ESP_OK;
+            if (httpd_query_key_value(query, "backfill", backfill, sizeof(backfill)) == ESP_OK) {
+                backfill_min = atoi(backfill);
+            }
+            has_resume = httpd_query_key_value(query, "resume", resume, sizeof(resume)) == ESP_OK;
+        }
+        // 客户端通过 Sec-WebSocket-Protocol 请求二进制子协议时，改用定长二进制帧（v2 语义）
+        char subproto[48];
+        if (httpd_req_get_hdr_value_str(req, "Sec-WebSocket-Protocol", subproto, sizeof(subproto)) == ESP_OK &&
+            strstr(subproto, WS_BIN_SUBPROTOCOL) != NULL) {
+            proto = WS_PROTO_BIN;
+        }
+        ESP_LOGI(TAG, "WebSocket 连接建立 (v%d)", proto);
+        int fd = httpd_req_to_sockfd(req);
+        if (ws_push_add_client(fd, proto, has_topics ? topics : NULL) == ESP_OK) {
+            if (has_resume) {
+                ws_push_resume(fd, resume);
+            } else if (backfill_min > 0) {
+                ws_push_backfill(fd, backfill_min);
+            }
+        }
         return ESP_OK;
     }
 
     // 处理网页发来的 WebSocket 数据帧
     httpd_ws_frame_t ws_pkt;
-    uint8_t *buf = NULL;
     memset(&ws_pkt, 0, sizeof(httpd_ws_frame_t));
     ws_pkt.type = HTTPD_WS_TYPE_TEXT;
 
@@ -133,67 +101,88 @@ static esp_err_t ws_handler(httpd_req_t *req)
         return ret;
     }
 
+    METRICS_INC(METRIC_WS_FRAMES_RECV);
+
+    // 控制帧：CLOSE 直接结束会话；PING 的 PONG 经发送队列回复，不能插进写了一半的推送帧中间
+    if (ws_pkt.type == HTTPD_WS_TYPE_CLOSE) {
+        return ESP_FAIL;
+    }
+    if (ws_pkt.type == HTTPD_WS_TYPE_PING || ws_pkt.type == HTTPD_WS_TYPE_PONG) {
+        uint8_t ping[125];
+        if (ws_pkt.len > sizeof(ping)) {
+            return ESP_FAIL;
+        }
+        ws_pkt.payload = ping;
+        ret = ws_pkt.len ? httpd_ws_recv_frame(req, &ws_pkt, ws_pkt.len) : ESP_OK;
+        if (ret == ESP_OK && ws_pkt.type == HTTPD_WS_TYPE_PING) {
+            ws_push_send_pong(req, ping, ws_pkt.len);
+        }
+        return ret;
+    }
+
     if (ws_pkt.len) {
-        buf = calloc(1, ws_pkt.len + 1);
-        if (buf == NULL) {
-            return ESP_ERR_NO_MEM;
+        // 客户端只发短文本命令，直接收进会话的接收缓冲，不再按帧 malloc
+        web_session_t *s = web_session_get(req);
+        if (s == NULL || ws_pkt.len >= sizeof(s->rx)) {
+            ESP_LOGW(TAG, "WebSocket 帧过长 (%u 字节) 或无会话缓冲，关闭连接", (unsigned)ws_pkt.len);
+            return ESP_FAIL;
         }
-        ws_pkt.payload = buf;
+        ws_pkt.payload = (uint8_t *)s->rx;
         ret = httpd_ws_recv_frame(req, &ws_pkt, ws_pkt.len);
         if (ret != ESP_OK) {
             ESP_LOGE(TAG, "获取 WebSocket 数据帧内容失败: %d", ret);
-            free(buf);
             return ret;
         }
+        s->rx[ws_pkt.len] = '\0';
         
-        // 打印前端发来的内容（比如 "get" 命令）
-        ESP_LOGI(TAG, "收到 WebSocket 消息: %s", ws_pkt.payload);
+        ESP_LOGD(TAG, "收到 WebSocket 消息: %s", s->rx);
         
-        // 当收到 "get" 请求时，我们立刻生成完整数据，封装成 WebSocket 专属帧推给网页
-        if(strcmp((char*)ws_pkt.payload, "get") == 0) {
-            char* json_response = generate_data_json();
-            if(json_response) {
-                httpd_ws_frame_t ws_resp;
-                memset(&ws_resp, 0, sizeof(httpd_ws_frame_t));
-                ws_resp.payload = (uint8_t*)json_response;
-                ws_resp.len = strlen(json_response);
-                ws_resp.type = HTTPD_WS_TYPE_TEXT;
-                
-                // 将数据帧沿着建立好的 WebSocket 通道直接“推(push)”回去
-                httpd_ws_send_frame(req, &ws_resp);
-                
-                free(json_response);
+        // v2 客户端发现消息序号缺口，请求重新推送完整快照
+        if (strcmp(s->rx, "resync") == 0) {
+            ws_push_resync(httpd_req_to_sockfd(req));
+        }
+        // 主题订阅："sub live:10,alarm" / "unsub diag"
+        else if (strncmp(s->rx, "sub ", 4) == 0) {
+            ws_push_subscribe(httpd_req_to_sockfd(req), s->rx + 4, true);
+        }
+        else if (strncmp(s->rx, "unsub ", 6) == 0) {
+            ws_push_subscribe(httpd_req_to_sockfd(req), s->rx + 6, false);
+        }
+        // 补发最近若干分钟的样本："backfill 5"
+        else if (strncmp(s->rx, "backfill ", 9) == 0) {
+            ws_push_backfill(httpd_req_to_sockfd(req), atoi(s->rx + 9));
+        }
+        // 控制命令请求：{"id": 7, "op": "set_alarm", ...}，回复带同一个 id
+        else if (s->rx[0] == '{') {
+            web_ctrl_ws_request(req, s->rx, ws_pkt.len);
+        }
+        // 断线续传："resume 1a2b3c4d-1234"，补发该样本之后的全部样本
+        else if (strncmp(s->rx, "resume ", 7) == 0) {
+            ws_push_resume(httpd_req_to_sockfd(req), s->rx + 7);
+        }
+        // 保活："hb" 只为让 httpd 刷新该 socket 的 LRU 位置，满连接时不先回收推送连接，无需回复
+        else if (strcmp(s->rx, "hb") == 0) {
+        }
+        // 数据已由服务端按采样周期主动推送，这里只为旧版网页/脚本保留 "get" 兼容
+        else if (strcmp(s->rx, "get") == 0) {
+            // 回复帧放在会话内存池里，请求结束后随内存池一起清空
+            char *json_response = web_request_alloc(s, DATA_JSON_BUF_SIZE);
+            int len = json_response ? data_json_write_full(json_response, DATA_JSON_BUF_SIZE) : -1;
+            if (len > 0) {
+                // 经该连接的发送队列送出，与推送帧共用同一个非阻塞写出路径
+                ws_push_reply(req, json_response, len);
             }
+            web_request_free(json_response);
         }
-        free(buf);
     }
     return ret;
 }
 
 
-//处理chart.js请求
-static esp_err_t chart_handler(httpd_req_t *req)
-{
-    // 设置响应类型为application/javascript
-    httpd_resp_set_type(req, "application/javascript");
-    // 设置内容编码为gzip
-    httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
-    // 发送chart.js内容
-    return httpd_resp_send(req, (const char *)_binary_chart_js_gz_start, _binary_chart_js_gz_end - _binary_chart_js_gz_start);
-}
-
-//处理时间同步请求
+//处理时间同步请求（请求体为 Unix 秒），实现见 web_ctrl.c
 static esp_err_t time_sync_handler(httpd_req_t *req)
 {
-    // 如果系统已经通过 NTP 获得了准确时间，就不再接受网页端的同步
-    if (g_is_ntp_synced) {
-        ESP_LOGI(TAG, "拒网页同步: 系统已连接网络并启用高质量 NTP 时间");
-        httpd_resp_sendstr(req, "OK"); // 虽然拒绝，但也给网页回OK让它别报错
-        return ESP_OK;
-    }
-
     char time_str[32];// 存储接收到的数据
-    int ret;//记录读取到的字节数，判断读取是否成功
     int remaining = req->content_len;//记录剩余未读取的字节数
 
     if (remaining >= sizeof(time_str))
@@ -202,7 +191,7 @@ static esp_err_t time_sync_handler(httpd_req_t *req)
     }
 
     //读取前端发来的数据
-    ret = httpd_req_recv(req, time_str, remaining);
+    int ret = httpd_req_recv(req, time_str, remaining);
     if (ret <= 0)    
     {
         // 读取失败，发送错误响应
@@ -210,44 +199,13 @@ static esp_err_t time_sync_handler(httpd_req_t *req)
     }
     time_str[ret] = '\0';//添加字符串结束符
 
-    //解析时间字符串
-    long timestamp = atol(time_str); //将字符串转换为长整数，得到时间戳
-    if (timestamp >0)
-    {
-        //设置系统时间
-        struct timeval tv = {
-            .tv_sec = (time_t)timestamp, //将时间戳赋值给tv_sec
-            .tv_usec = 0
-        };
-        settimeofday(&tv, NULL);//调用settimeofday函数设置系统时间
-
-        //设置时区
-        setenv("TZ", "CST-8", 1); //设置时区为中国标准时间
-        tzset(); //应用时区设置
-
-        time_sync_done = true;//设置时间同步完成的标志位
-
-        //打印同步后的时间
-        time_t now = time(NULL);
-        struct tm timeinfo;
-        localtime_r(&now, &timeinfo);
-        char strftime_buf[64];
-        strftime(strftime_buf, sizeof(strftime_buf), "%c", &timeinfo);
-        ESP_LOGI(TAG, "系统时间同步为: %s", strftime_buf);
-
-        //发送成功响应
-        const char* response = "时间同步成功";
-        return httpd_resp_send(req, response, strlen(response));
-    }
-    else
-    {
-        //时间戳无效，发送错误响应
-        const char* response = "时间戳无效";
-        return httpd_resp_send(req, response, strlen(response));
-    }  
+    esp_err_t err = web_ctrl_sync_time(atol(time_str));
+    // 已由 NTP 对时时虽然拒绝，但也给网页回 OK 让它别报错
+    const char *response = err == ESP_OK ? "时间同步成功" : (err == ESP_ERR_NOT_SUPPORTED ? "OK" : "时间戳无效");
+    return httpd_resp_send(req, response, strlen(response));
 }
 
-// 处理 Wi-Fi 配置请求的处理器 
+// 处理 Wi-Fi 配置请求的处理器，实现见 web_ctrl.c
 static esp_err_t wifi_config_handler(httpd_req_t *req)
 {
     char buffer[200]; // 用于存放接收的 JSON 字符串
@@ -269,96 +227,46 @@ static esp_err_t wifi_config_handler(httpd_req_t *req)
     }
     buffer[ret] = '\0'; // 结束符
 
-    ESP_LOGI(TAG, "收到配网数据: %s", buffer);
-
-    // 解析 JSON
-    cJSON *root = cJSON_Parse(buffer);
-    if (root == NULL) {
-        ESP_LOGE(TAG, "JSON 解析失败");
-        httpd_resp_send_500(req);
-        return ESP_FAIL;
-    }
-
-    cJSON *ssid_item = cJSON_GetObjectItem(root, "ssid");
-    cJSON *pwd_item = cJSON_GetObjectItem(root, "password");
-
-    if (ssid_item && pwd_item && cJSON_IsString(ssid_item) && cJSON_IsString(pwd_item)) {
-        // 成功提取 SSID 和 密码
-        const char *new_ssid = ssid_item->valuestring;
-        const char *new_pwd = pwd_item->valuestring;
-        ESP_LOGI(TAG, "准备连接 -> SSID: %s, Password: %s", new_ssid, new_pwd);
-        // 保存到 NVS 
-        nvs_handle_t my_handle;
-        esp_err_t err = nvs_open("storage", NVS_READWRITE, &my_handle);
-        if (err == ESP_OK) {
-            nvs_set_str(my_handle, "wifi_ssid", new_ssid);
-            nvs_set_str(my_handle, "wifi_pass", new_pwd);
-            nvs_commit(my_handle);
-            nvs_close(my_handle);
-            ESP_LOGI(TAG, "Wi-Fi 信息已保存至 NVS");
-        } else {
-            ESP_LOGE(TAG, "NVS 打开失败，未保存 Wi-Fi 信息");
-        }
-        // 应用新的 STA 配置
-        wifi_config_t sta_config = {0};
-        strncpy((char *)sta_config.sta.ssid, new_ssid, sizeof(sta_config.sta.ssid) - 1);
-        strncpy((char *)sta_config.sta.password, new_pwd, sizeof(sta_config.sta.password) - 1);
-        
-        // 断开现有的连接 -> 重新设置参数 -> 重新连接
-        esp_wifi_disconnect();
-        esp_wifi_set_config(WIFI_IF_STA, &sta_config);
-        esp_wifi_connect();
-
-        // 等待获取 IP 地址 (最多等 8 秒)
-        esp_netif_t *netif_sta = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
-        esp_netif_ip_info_t ip_info;
-        int retry_count = 0;
-        bool got_ip = false;
-        
-        while (retry_count < 80) { // 80 * 100ms = 8s
-            vTaskDelay(100 / portTICK_PERIOD_MS);
-            if (netif_sta && esp_netif_get_ip_info(netif_sta, &ip_info) == ESP_OK) {
-                if (ip_info.ip.addr != 0) { // IP 不为 0 说明拿到了
-                    got_ip = true;
-                    break;
-                }
-            }
-            retry_count++;
-        }
 
-        // 发送带 IP 的响应
-        char response[128];
-        if (got_ip) {
-            snprintf(response, sizeof(response), "{\"status\":\"ok\", \"ip\":\"" IPSTR "\"}", IP2STR(&ip_info.ip));
-        } else {
-            snprintf(response, sizeof(response), "{\"status\":\"timeout\"}");
-        }
-        
+    // 就地解析：ssid / password 直接指向 buffer 中反转义后的字符串
+    web_ctrl_wifi_args_t args;
+    uint32_t job_id;
+    int r = json_read(buffer, ret, web_ctrl_wifi_fields, WEB_CTRL_WIFI_FIELDS, &args);
+    esp_err_t err = r == JSON_OK ? web_ctrl_wifi_config(args.ssid, args.password, &job_id) : ESP_ERR_INVALID_ARG;
+    if (err == ESP_OK) {
+        char response[64];
+        json_writer_t w;
+        json_writer_init_http(&w, req, response, sizeof(response));
+        httpd_resp_set_status(req, "202 Accepted");
         httpd_resp_set_type(req, "application/json");
-        httpd_resp_send(req, response, strlen(response));
+        json_obj_begin(&w);
+        json_kv_str(&w, "status", "accepted");
+        json_kv_uint(&w, "job", job_id);
+        json_obj_end(&w);
+        json_writer_send(&w);
+    } else if (r == JSON_OK) {
+        // 账号没能保存，重启后不会保留：如实告诉客户端，不回 accepted
+        httpd_resp_set_status(req, "500 Internal Server Error");
+        httpd_resp_set_type(req, "application/json");
+        httpd_resp_sendstr(req, "{\"status\":\"error\",\"reason\":\"nvs\"}");
     } else {
-        ESP_LOGE(TAG, "JSON 字段不完整");
+        ESP_LOGE(TAG, "JSON 解析失败或字段不完整 (%d)", r);
         httpd_resp_send_500(req);
     }
 
-    // 释放 JSON 对象内存
-    cJSON_Delete(root);
-
     return ESP_OK;
 }
 
-// 异步保存任务，防止大块擦除闪存时卡住整个网络
-static void save_alarm_task(void *pvParameters) {
-    nvs_handle_t my_handle;
-    if (nvs_open("storage", NVS_READWRITE, &my_handle) == ESP_OK) {
-        char val_str[16];
-        snprintf(val_str, sizeof(val_str), "%.1f", g_alarm_threshold);
-        nvs_set_str(my_handle, "alarm_thresh", val_str);
-        nvs_commit(my_handle);
-        nvs_close(my_handle);
-        ESP_LOGI(TAG, "已异步保存报警阈值到 NVS: %s", val_str);
-    }
-    vTaskDelete(NULL);
+// 查询后台配网任务进度
+static esp_err_t wifi_status_handler(httpd_req_t *req)
+{
+    char buf[128];
+    json_writer_t w;
+    json_writer_init_http(&w, req, buf, sizeof(buf));
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    data_json_prov(&w, false);
+    return json_writer_send(&w);
 }
 
 // 处理设置报警阈值的POST请求
@@ -378,129 +286,107 @@ static esp_err_t set_alarm_handler(httpd_req_t *req)
     }
     buffer[ret] = '\0';
 
-    cJSON *root = cJSON_Parse(buffer);
-    if (root == NULL) {
-        httpd_resp_send_500(req);
-        return ESP_FAIL;
-    }
-
-    cJSON *threshold_item = cJSON_GetObjectItem(root, "threshold");
-    if (threshold_item && cJSON_IsNumber(threshold_item)) {
-        g_alarm_threshold = threshold_item->valuedouble;
-        ESP_LOGI(TAG, "收到新报警阈值: %.1f", g_alarm_threshold);
-
-        // 创建异步 NVS 存储任务，立即释放当前 HTTP 线程
-        xTaskCreate(save_alarm_task, "save_alarm_task", 3072, NULL, 4, NULL);
-
+    web_ctrl_alarm_args_t args;
+    int r = json_read(buffer, ret, web_ctrl_alarm_fields, WEB_CTRL_ALARM_FIELDS, &args);
+    // 立即生效并推送给其他客户端，实现见 web_ctrl.c
+    if (r == JSON_OK && web_ctrl_set_alarm(args.threshold_x10 / 10.0f) == ESP_OK) {
         const char* response = "{\"status\":\"ok\"}";
         httpd_resp_set_type(req, "application/json");
         httpd_resp_send(req, response, strlen(response));
+    } else if (r == JSON_OK || r == JSON_ERR_RANGE) {
+        // 超出范围（-20 ~ 80 ℃）
+        const char* response = "{\"status\":\"error\", \"reason\":\"out_of_range\"}";
+        httpd_resp_set_status(req, HTTPD_400);
+        httpd_resp_set_type(req, "application/json");
+        httpd_resp_send(req, response, strlen(response));
     } else {
         httpd_resp_send_500(req);
     }
-
-    cJSON_Delete(root);
     return ESP_OK;
 }
 
+// 配网状态变化回调（Wi-Fi 事件任务中调用），转交给推送模块
+static void on_wifi_prov_changed(void *arg)
+{
+    ws_push_prov_changed();
+}
+
+// 会话关闭回调：把 WebSocket / SSE 客户端从推送列表中移除
+static void web_close_fn(httpd_handle_t hd, int sockfd)
+{
+    ws_push_remove_client(sockfd);
+    sse_remove_client(sockfd);
+    web_ctrl_session_closed(sockfd);
+    // 设置了 close_fn 后需要自己关闭 socket
+    close(sockfd);
+}
+
+// 路由表
+// async = true：可能较慢（读写 NVS、整段历史、基准测试），在工作线程执行，队列满时回 503
+// 实时数据和静态资源等快接口留在 httpd 任务里直接处理
+// 静态资源由 "/*" 通配处理函数统一提供，必须放在最后
+static web_route_t s_routes[] = {
+    { .uri = "/ws",           .method = HTTP_GET,  .handler = ws_handler,           // WebSocket 推送通道
+      .websocket = true, .subprotocol = WS_BIN_SUBPROTOCOL },                          // 握手时回应二进制子协议
+    { .uri = "/data",         .method = HTTP_GET,  .handler = data_handler },          // 旧版整包数据
+    { .uri = "/api/live",     .method = HTTP_GET,  .handler = api_live_handler },      // 拆分数据接口，各自带 ETag
+    { .uri = "/api/today",    .method = HTTP_GET,  .handler = api_today_handler },
+    { .uri = "/api/history",  .method = HTTP_GET,  .handler = api_history_handler,  .async = true },
+    { .uri = "/api/recent",   .method = HTTP_GET,  .handler = api_recent_handler,   .async = true }, // 最近样本补发
+    { .uri = "/api/series",   .method = HTTP_GET,  .handler = api_series_handler,   .async = true }, // 降采样趋势序列
+    { .uri = "/spark.svg",    .method = HTTP_GET,  .handler = api_spark_handler,    .async = true }, // 设备端绘制的迷你曲线图
+    { .uri = "/sync_time",    .method = HTTP_POST, .handler = time_sync_handler,    .control = true }, // 网页时间同步
+    { .uri = "/set_alarm",    .method = HTTP_POST, .handler = set_alarm_handler,    .control = true }, // 设置报警阈值
+    { .uri = "/wifi_config",  .method = HTTP_POST, .handler = wifi_config_handler,  .async = true, .control = true }, // 配网（写 NVS）
+    { .uri = "/events",       .method = HTTP_GET,  .handler = sse_handler },           // SSE 推送（保持连接）
+    { .uri = "/wifi_status",  .method = HTTP_GET,  .handler = wifi_status_handler,  .control = true }, // 配网进度
+    { .uri = "/diag/bench",   .method = HTTP_GET,  .handler = diag_bench_handler,   .async = true }, // 编码基准测试
+    { .uri = "/metrics",      .method = HTTP_GET,  .handler = metrics_http_handler },  // Prometheus 指标
+    { .uri = "/diag/trace",   .method = HTTP_GET,  .handler = diag_trace_handler },    // 追踪区间导出（Chrome trace）
+    { .uri = "/diag/handlers", .method = HTTP_GET, .handler = web_route_stats_handler },             // 各接口耗时统计
+    { .uri = "/*",            .method = HTTP_GET,  .handler = web_assets_handler },    // 构建生成的静态资源
+};
+
 // 定义一个函数，用于启动web服务器
 httpd_handle_t start_webserver(void)
 {
-    // 从 NVS 中加载之前保存的报警阈值，如存在
-    nvs_handle_t my_handle;
-    if (nvs_open("storage", NVS_READONLY, &my_handle) == ESP_OK) {
-        char val_str[16];
-        size_t required_size = sizeof(val_str);
-        if (nvs_get_str(my_handle, "alarm_thresh", val_str, &required_size) == ESP_OK) {
-            g_alarm_threshold = atof(val_str);
-            ESP_LOGI(TAG, "从 NVS 加载报警阈值: %.1f", g_alarm_threshold);
-        }
-        nvs_close(my_handle);
-    }
-
     // 定义一个httpd_config_t类型的变量，用于存储httpd的配置信息
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
     // 允许服务器抛弃旧的闲置会话（Zombie Connection / 幽灵连接）
     // 防止手机App切换网络时没有发fin断开TCP，导致占满 socket 使其他端（比如PC）无法连接
+    // 只收推送的 WebSocket 也不会被当成闲置连接回收：首页每 5 秒发一条 "hb"，httpd 收到数据就刷新它的 LRU 位置
     config.lru_purge_enable = true;
-    config.recv_wait_timeout = 10; // 给 WebSockets 足够的心跳容忍时间（前端每2秒发一次）
+    config.recv_wait_timeout = 10; // 单次接收的超时：请求头/正文分段到达时最多等 10 秒（与连接闲置多久无关）
+    config.open_fn = web_limit_on_open; // 按来源 IP 限制新建连接的频率
+    config.close_fn = web_close_fn; // 跟踪 WebSocket 客户端的断开
+    config.max_uri_handlers = 24; // 默认 8 个不够用
+    config.max_open_sockets = WEB_SESSION_MAX; // 每个 socket 对应一份预分配的会话缓冲
+    config.uri_match_fn = httpd_uri_match_wildcard; // 静态资源使用 "/*" 通配
 
     // 定义一个httpd_handle_t类型的变量，用于存储httpd的句柄
     httpd_handle_t server = NULL;
 
+    // 会话缓冲池须在 httpd 接收第一个请求前分配好
+    if (web_session_init() != ESP_OK) {
+        return NULL;
+    }
+
     // 如果httpd_start函数返回值为ESP_OK，则表示启动成功
     if (httpd_start(&server, &config) == ESP_OK) {
-        // 定义一个httpd_uri_t类型的变量，用于存储uri的配置信息
-        httpd_uri_t index_uri = {
-            // 设置uri的路径
-            .uri       = "/",
-            // 设置uri的方法为GET
-            .method    = HTTP_GET,
-            .handler   = index_handler,
-            // 设置uri的用户上下文为NULL
-            .user_ctx  = NULL
-        };
-        // 注册uri的处理函数
-        httpd_register_uri_handler(server, &index_uri);
-
-
-        // 定义数据API的URI
-        httpd_uri_t data_uri = {
-            .uri       = "/data",
-            .method    = HTTP_GET,
-            .handler   = data_handler,
-            .user_ctx  = NULL
-        };
-        // 注册数据处理函数
-        httpd_register_uri_handler(server, &data_uri);
-
-        // 定义chart.js的URI
-        httpd_uri_t chart_uri = {
-            .uri       = "/chart.js",
-            .method    = HTTP_GET,
-            .handler   = chart_handler,
-            .user_ctx  = NULL
-        };
-        // 注册chart.js处理函数
-        httpd_register_uri_handler(server, &chart_uri);
-
-        // 定义时间同步的URI
-        httpd_uri_t time_sync_uri = {
-            .uri       = "/sync_time",
-            .method    = HTTP_POST, // POST方法
-            .handler   = time_sync_handler,
-            .user_ctx  = NULL
-        };
-        // 注册时间同步处理函数
-        httpd_register_uri_handler(server, &time_sync_uri);
-
-        // 注册设置报警值的处... (缩写，见下)
-        httpd_uri_t set_alarm_uri = {
-            .uri       = "/set_alarm",
-            .method    = HTTP_POST,
-            .handler   = set_alarm_handler,
-            .user_ctx  = NULL
-        };
-        httpd_register_uri_handler(server, &set_alarm_uri);
-
-        // 注册强大的 WebSocket 通信接口
-        httpd_uri_t ws_uri = {
-            .uri        = "/ws",
-            .method     = HTTP_GET, // WebSocket 握手总是用 GET
-            .handler    = ws_handler,
-            .user_ctx   = NULL,
-            .is_websocket = true    // 最核心代码：告诉系统这是专门处理 WebSocket 的接口
-        };
-        httpd_register_uri_handler(server, &ws_uri);
-
-        // 注册配网接口的 URI
-        httpd_uri_t wifi_config_uri = {
-            .uri       = "/wifi_config",
-            .method    = HTTP_POST,   // 前端用 POST 提交
-            .handler   = wifi_config_handler,
-            .user_ctx  = NULL
-        };
-        httpd_register_uri_handler(server, &wifi_config_uri);
+        // 慢接口交给异步工作线程，避免阻塞其他 socket
+        web_async_start();
+
+        // 所有接口统一经路由表注册：统计耗时，标记为异步的交给工作线程
+        for (size_t i = 0; i < sizeof(s_routes) / sizeof(s_routes[0]); i++) {
+            web_route_register(server, &s_routes[i]);
+        }
+
+        // 开启 WebSocket 主动推送：每个采样周期广播一次
+        ws_push_start(server);
+        sse_start();
+        metrics_http_start();
+        // 配网状态变化也通过 WebSocket 推送
+        wifi_prov_register_cb(on_wifi_prov_changed, NULL);
     }
 
     // 返回httpd的句柄
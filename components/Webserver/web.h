@@ -1,8 +1,12 @@
 #ifndef WEB_H
 #define WEB_H
 
+#include <stdbool.h>
 #include "esp_http_server.h"
 
+// 网页端对时是否完成（联网后由 NTP 对时，见 g_is_ntp_synced）
+extern bool time_sync_done;
+
 // 启动web服务器的函数声明
 httpd_handle_t start_webserver(void);
 
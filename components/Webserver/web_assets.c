@@ -0,0 +1,235 @@
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "esp_rom_crc.h"
+#include "http_cache.h"
+#include "data_json.h"
+#include "web_session.h"
+#include "web_assets.h"
+
+// 与 tools/gen_web_assets.py 中的 path_hash() 保持一致：带种子的 FNV-1a + 末尾混合
+static uint32_t web_asset_hash(const char *path, size_t len, uint32_t seed)
+{
+    uint32_t h = 2166136261u ^ seed;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (uint8_t)path[i];
+        h *= 16777619u;
+    }
+    h ^= h >> 15;
+    h *= 0x2c1b3c6du;
+    h ^= h >> 12;
+    return h;
+}
+
+const web_asset_t *web_asset_find(const char *path, size_t len)
+{
+    uint8_t idx = web_asset_slots[web_asset_hash(path, len, web_asset_hash_seed) & web_asset_slot_mask];
+    if (idx >= web_assets_count) {
+        return NULL;
+    }
+    // 槽位只保证已知路径不冲突，未知路径仍需比对确认
+    const web_asset_t *asset = &web_assets[idx];
+    if (strncmp(asset->path, path, len) != 0 || asset->path[len] != '\0') {
+        return NULL;
+    }
+    return asset;
+}
+
+// Accept-Encoding 中是否接受某种编码（忽略 q=0 的项）
+static bool accepts_encoding(const char *header, const char *coding)
+{
+    size_t coding_len = strlen(coding);
+    const char *p = header;
+    while (*p) {
+        while (*p == ' ' || *p == ',') {
+            p++;
+        }
+        const char *token = p;
+        while (*p && *p != ',' && *p != ';' && *p != ' ') {
+            p++;
+        }
+        bool match = ((size_t)(p - token) == coding_len && strncasecmp(token, coding, coding_len) == 0);
+
+        // 解析参数部分，只关心 q=0
+        bool rejected = false;
+        while (*p && *p != ',') {
+            if (*p == ';') {
+                const char *q = p + 1;
+                while (*q == ' ') {
+                    q++;
+                }
+                if ((q[0] == 'q' || q[0] == 'Q') && q[1] == '=' && atof(q + 2) <= 0.0) {
+                    rejected = true;
+                }
+            }
+            p++;
+        }
+        if (match) {
+            return !rejected;
+        }
+    }
+    return false;
+}
+
+esp_err_t web_asset_send(httpd_req_t *req, const web_asset_t *asset)
+{
+    const uint8_t *body = asset->identity;
+    size_t body_len = asset->identity_len;
+    const char *encoding = NULL;
+    const char *suffix = "";
+
+    char accept[96];
+    if (httpd_req_get_hdr_value_str(req, "Accept-Encoding", accept, sizeof(accept)) != ESP_OK) {
+        accept[0] = '\0';
+    }
+    if (asset->br && accepts_encoding(accept, "br")) {
+        body = asset->br;
+        body_len = asset->br_len;
+        encoding = "br";
+        suffix = "-br";
+    } else if (asset->gzip && accepts_encoding(accept, "gzip")) {
+        body = asset->gzip;
+        body_len = asset->gzip_len;
+        encoding = "gzip";
+        suffix = "-gz";
+    }
+
+    // 强 ETag 要区分不同编码的表示
+    char etag[HTTP_ETAG_LEN];
+    snprintf(etag, sizeof(etag), "\"%s%s\"", asset->hash, suffix);
+
+    httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+    if (http_cache_check(req, etag, asset->cache_control)) {
+        return ESP_OK;
+    }
+
+    httpd_resp_set_type(req, asset->mime);
+    if (encoding) {
+        httpd_resp_set_hdr(req, "Content-Encoding", encoding);
+    }
+    // 内容直接从 flash 发出，不做拷贝
+    return httpd_resp_send(req, (const char *)body, body_len);
+}
+
+// GF(2) 上 a * b mod P（CRC-32 反射表示），与 tools/gen_web_assets.py 中的 crc32_multmodp() 一致
+static uint32_t crc32_multmodp(uint32_t a, uint32_t b)
+{
+    uint32_t m = 1u << 31;
+    uint32_t p = 0;
+    for (;;) {
+        if (a & m) {
+            p ^= b;
+            if ((a & (m - 1)) == 0) {
+                break;
+            }
+        }
+        m >>= 1;
+        b = (b & 1) ? (b >> 1) ^ 0xedb88320u : b >> 1;
+    }
+    return p;
+}
+
+static void put_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+esp_err_t web_asset_send_state(httpd_req_t *req, const web_asset_t *asset)
+{
+    // 状态 JSON 放在会话内存池里，请求结束随内存池回收
+    char *state = web_request_alloc(web_session_get(req), DATA_JSON_BUF_SIZE);
+    if (state == NULL) {
+        httpd_resp_send_500(req);
+        return ESP_ERR_NO_MEM;
+    }
+    const char *inject = state;
+    int len = data_json_write_boot(state, DATA_JSON_BUF_SIZE);
+    if (len < 0) {
+        // 放不下时保留占位符原文（null），页面照常自己请求数据
+        inject = (const char *)asset->identity + asset->state_at;
+        len = (int)asset->state_len;
+    }
+    const uint8_t *tail = asset->identity + asset->state_at + asset->state_len;
+    size_t tail_len = asset->identity_len - asset->state_at - asset->state_len;
+
+    char accept[96];
+    if (httpd_req_get_hdr_value_str(req, "Accept-Encoding", accept, sizeof(accept)) != ESP_OK) {
+        accept[0] = '\0';
+    }
+    bool gzip = asset->gzip_head != NULL && accepts_encoding(accept, "gzip");
+
+    httpd_resp_set_type(req, asset->mime);
+    httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+
+    // gzip：前段以 full flush 结束、按字节对齐，状态作为一个 deflate 不压缩块（BFINAL=0、BTYPE=00，
+    // 之后是 LEN 与 ~LEN）插入，接着是独立压缩的后段，最后补上整页的 CRC32 与长度。
+    // 前后两段的 CRC 在构建时算好，运行时只对状态算 CRC，再乘上后段的推进因子拼接
+    uint8_t stored[5];
+    uint8_t trailer[8];
+    struct {
+        const void *data;
+        size_t len;
+    } parts[5];
+    int n = 0;
+    if (gzip) {
+        uint16_t ulen = (uint16_t)len;
+        stored[0] = 0x00;
+        stored[1] = (uint8_t)ulen;
+        stored[2] = (uint8_t)(ulen >> 8);
+        stored[3] = (uint8_t)~ulen;
+        stored[4] = (uint8_t)(~ulen >> 8);
+        uint32_t crc = esp_rom_crc32_le(asset->crc_head, (const uint8_t *)inject, len);
+        crc = crc32_multmodp(asset->crc_tail_shift, crc) ^ asset->crc_tail;
+        put_le32(trailer, crc);
+        put_le32(trailer + 4, (uint32_t)(asset->state_at + len + tail_len));
+        httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+        parts[n].data = asset->gzip_head, parts[n++].len = asset->gzip_head_len;
+        parts[n].data = stored, parts[n++].len = sizeof(stored);
+        parts[n].data = inject, parts[n++].len = len;
+        parts[n].data = asset->gzip_tail, parts[n++].len = asset->gzip_tail_len;
+        parts[n].data = trailer, parts[n++].len = sizeof(trailer);
+    } else {
+        parts[n].data = asset->identity, parts[n++].len = asset->state_at;
+        parts[n].data = inject, parts[n++].len = len;
+        parts[n].data = tail, parts[n++].len = tail_len;
+    }
+
+    // 模板部分直接从 flash 分块发出，不做拷贝
+    esp_err_t err = ESP_OK;
+    for (int i = 0; i < n && err == ESP_OK; i++) {
+        err = httpd_resp_send_chunk(req, (const char *)parts[i].data, parts[i].len);
+    }
+    if (err == ESP_OK) {
+        err = httpd_resp_send_chunk(req, NULL, 0);
+    }
+    web_request_free(state);
+    return err;
+}
+
+esp_err_t web_assets_handler(httpd_req_t *req)
+{
+    // 查询串（如 ?v=哈希）只用于缓存区分，查找时忽略
+    const char *uri = req->uri;
+    size_t len = strcspn(uri, "?#");
+
+    const web_asset_t *asset;
+    if (len == 1 && uri[0] == '/') {
+        asset = web_asset_find("/index.html", strlen("/index.html"));
+    } else {
+        asset = web_asset_find(uri, len);
+    }
+
+    if (asset == NULL) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Not Found");
+        return ESP_OK;
+    }
+    if (asset->state_len > 0) {
+        return web_asset_send_state(req, asset);
+    }
+    return web_asset_send(req, asset);
+}
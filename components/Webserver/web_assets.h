@@ -0,0 +1,61 @@
+#ifndef WEB_ASSETS_H
+#define WEB_ASSETS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_http_server.h"
+
+// 长期缓存：用于页面以带版本号地址引用的资源（内容变化时地址跟着变）
+#define WEB_ASSET_CACHE_IMMUTABLE "public, max-age=31536000, immutable"
+// 每次校验：用于地址固定的资源，命中 ETag 时只回 304
+#define WEB_ASSET_CACHE_REVALIDATE "no-cache"
+
+// 页面状态占位符：HTML 中出现这段文字时，发送页面时替换为当前状态 JSON（见 data_json_write_boot）
+#define WEB_ASSET_STATE_MARK "/*@STATE@*/null"
+
+// 构建时由 tools/gen_web_assets.py 扫描 www/ 目录生成的静态资源（web_assets_data.c）
+// 每个资源都带原文、gzip 和可选的 brotli 版本，全部常驻 flash
+typedef struct {
+    const char *path;           // 访问路径，例如 "/index.html"
+    const char *mime;           // Content-Type
+    const char *cache_control;  // Cache-Control 策略
+    const char *hash;           // 原文 SHA-256 前 16 位十六进制，用作 ETag
+    const uint8_t *identity;    // 未压缩内容（HTML 已最小化）
+    size_t identity_len;
+    const uint8_t *gzip;        // gzip 压缩内容，已是压缩格式的资源为 NULL
+    size_t gzip_len;
+    const uint8_t *br;          // brotli 压缩内容，构建环境没有 brotli 时为 NULL
+    size_t br_len;
+    // 带状态占位符的页面（state_len 不为 0）：在占位符处切成两段，发送时把当前状态插在中间，
+    // 不生成整页的 gzip / brotli 版本，gzip 由下面两段拼接
+    size_t state_at;            // 占位符在 identity 中的偏移
+    size_t state_len;           // 占位符长度
+    const uint8_t *gzip_head;   // gzip 头 + 前段的 deflate 数据（以 full flush 结束，按字节对齐）
+    size_t gzip_head_len;
+    const uint8_t *gzip_tail;   // 后段独立的 deflate 数据（含结束块，不含 gzip 尾部）
+    size_t gzip_tail_len;
+    uint32_t crc_head;          // 前段原文的 CRC32
+    uint32_t crc_tail;          // 后段原文的 CRC32
+    uint32_t crc_tail_shift;    // x^(8 × 后段长度) mod P，把前面的 CRC 推进到后段之后
+} web_asset_t;
+
+// 生成的资源表与完美哈希槽位表
+extern const web_asset_t web_assets[];
+extern const size_t web_assets_count;
+extern const uint32_t web_asset_hash_seed;
+extern const uint32_t web_asset_slot_mask;
+extern const uint8_t web_asset_slots[];
+
+// 按路径查找资源（len 为路径长度，不含查询串），找不到返回 NULL
+const web_asset_t *web_asset_find(const char *path, size_t len);
+
+// 按 Accept-Encoding 选择最合适的编码发送资源，并处理 ETag / If-None-Match
+esp_err_t web_asset_send(httpd_req_t *req, const web_asset_t *asset);
+
+// 发送带状态占位符的页面：前后两段直接从 flash 分块发出，中间插入当前状态，不缓存
+esp_err_t web_asset_send_state(httpd_req_t *req, const web_asset_t *asset);
+
+// 通配静态资源处理函数，注册为 "/*" 且必须最后注册；"/" 映射到 "/index.html"
+esp_err_t web_assets_handler(httpd_req_t *req);
+
+#endif // WEB_ASSETS_H
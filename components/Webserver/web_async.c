@@ -0,0 +1,252 @@
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "web_async.h"
+#include "web_session.h"
+#include "web_limit.h"
+#include "json_writer.h"
+
+static const char *TAG = "WEB_ASYNC";
+
+// 已注册的路由，供统计接口遍历（不超过 httpd 的 max_uri_handlers）
+#define WEB_ROUTE_MAX 24
+
+// 排队中的异步请求：请求副本由工作线程负责完成并释放；
+// fn 不为空时是 web_async_submit 提交的任务，没有请求副本
+typedef struct {
+    httpd_req_t *req;
+    web_route_t *route;
+    int64_t enqueue_us;
+    void (*fn)(void *arg);
+    void *arg;
+} web_async_job_t;
+
+static QueueHandle_t s_job_queue = NULL;
+static web_route_t *s_routes[WEB_ROUTE_MAX];
+static int s_route_count = 0;
+
+static void route_record(web_route_t *route, esp_err_t ret, int64_t start_us, int64_t wait_us, uint32_t allocs)
+{
+    metrics_hist_observe(&route->stats.latency, (uint32_t)(esp_timer_get_time() - start_us));
+    if (route->async) {
+        metrics_hist_observe(&route->stats.wait, (uint32_t)wait_us);
+    }
+    if (ret != ESP_OK) {
+        metrics_counter_add(&route->stats.errors, 1);
+    }
+    if (allocs) {
+        metrics_counter_add(&route->stats.allocs, allocs);
+    }
+}
+
+// 在会话内存池的作用域内执行处理函数，结束后清空内存池；返回期间的堆分配次数（需开启分配检查）
+static esp_err_t route_run(web_route_t *route, httpd_req_t *req, uint32_t *allocs)
+{
+    web_session_t *s = (web_session_t *)req->sess_ctx;
+    uint32_t mark = web_alloc_count();
+    web_request_begin(s);
+    esp_err_t ret = route->handler(req);
+    web_request_end(s);
+    *allocs = web_alloc_count() - mark;
+    return ret;
+}
+
+static void web_async_worker(void *pvParameters)
+{
+    web_async_job_t job;
+    while (1) {
+        if (xQueueReceive(s_job_queue, &job, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        if (job.fn != NULL) {
+            job.fn(job.arg);
+            continue;
+        }
+        int64_t start = esp_timer_get_time();
+        uint32_t allocs;
+        esp_err_t ret = route_run(job.route, job.req, &allocs);
+        // 完成后 httpd 才会继续处理这个 socket 上的下一个请求
+        httpd_req_async_handler_complete(job.req);
+        route_record(job.route, ret, start, start - job.enqueue_us, allocs);
+    }
+}
+
+// 排队已满：直接回 503，让客户端稍后重试，不阻塞 httpd 任务
+static esp_err_t web_async_reject(httpd_req_t *req, web_route_t *route)
+{
+    metrics_counter_add(&route->stats.rejected, 1);
+
+    ESP_LOGW(TAG, "工作队列已满，拒绝 %s", route->uri);
+    httpd_resp_set_status(req, "503 Service Unavailable");
+    httpd_resp_set_hdr(req, "Retry-After", "1");
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_sendstr(req, "{\"status\":\"busy\"}");
+}
+
+// 所有路由的统一入口：同步接口直接执行并计时，异步接口复制请求后入队
+static esp_err_t web_route_dispatch(httpd_req_t *req)
+{
+    web_route_t *route = (web_route_t *)req->user_ctx;
+
+    // 按来源限流；WebSocket 只在握手时检查，连上之后的数据帧必须照常读走
+    if ((!route->websocket || req->method == HTTP_GET) && !web_limit_allow(req, route->control)) {
+        return web_limit_reject(req);
+    }
+
+    // 在 httpd 任务中绑定会话缓冲，异步请求副本沿用同一个 sess_ctx
+    web_session_get(req);
+
+    if (!route->async) {
+        int64_t start = esp_timer_get_time();
+        uint32_t allocs;
+        esp_err_t ret = route_run(route, req, &allocs);
+        route_record(route, ret, start, 0, allocs);
+        return ret;
+    }
+
+    if (uxQueueSpacesAvailable(s_job_queue) == 0) {
+        return web_async_reject(req, route);
+    }
+
+    web_async_job_t job = {
+        .route = route,
+        .enqueue_us = esp_timer_get_time(),
+    };
+    if (httpd_req_async_handler_begin(req, &job.req) != ESP_OK) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+    // 只有 httpd 任务会入队，上面已确认有空位，这里不会失败；保险起见仍做清理
+    if (xQueueSend(s_job_queue, &job, 0) != pdTRUE) {
+        httpd_req_async_handler_complete(job.req);
+        return web_async_reject(req, route);
+    }
+    return ESP_OK;
+}
+
+esp_err_t web_async_submit(void (*fn)(void *arg), void *arg)
+{
+    web_async_job_t job = {
+        .fn = fn,
+        .arg = arg,
+        .enqueue_us = esp_timer_get_time(),
+    };
+    if (s_job_queue == NULL || xQueueSend(s_job_queue, &job, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "工作队列已满，拒绝后台任务");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t web_async_start(void)
+{
+    if (s_job_queue != NULL) {
+        return ESP_OK;
+    }
+    s_job_queue = xQueueCreate(WEB_ASYNC_QUEUE_LEN, sizeof(web_async_job_t));
+    if (s_job_queue == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    for (int i = 0; i < WEB_ASYNC_WORKERS; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "web_async_%d", i);
+        if (xTaskCreatePinnedToCore(web_async_worker, name, WEB_ASYNC_STACK_SIZE, NULL,
+                                    WEB_ASYNC_PRIORITY, NULL, WEB_ASYNC_CORE) != pdPASS) {
+            ESP_LOGE(TAG, "创建工作线程失败");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    ESP_LOGI(TAG, "异步工作线程 x%d 已启动 (核 %d, 队列 %d)", WEB_ASYNC_WORKERS, WEB_ASYNC_CORE, WEB_ASYNC_QUEUE_LEN);
+    return ESP_OK;
+}
+
+esp_err_t web_route_register(httpd_handle_t server, web_route_t *route)
+{
+    if (s_route_count >= WEB_ROUTE_MAX) {
+        return ESP_ERR_NO_MEM;
+    }
+    httpd_uri_t uri = {
+        .uri      = route->uri,
+        .method   = route->method,
+        .handler  = web_route_dispatch,
+        .user_ctx = route,
+        .is_websocket = route->websocket,
+        // 推送帧经非阻塞发送队列写出，PONG 等控制帧也要由处理函数经同一队列回复
+        .handle_ws_control_frames = route->websocket,
+        .supported_subprotocol = route->subprotocol,
+    };
+    esp_err_t err = httpd_register_uri_handler(server, &uri);
+    if (err == ESP_OK) {
+        s_routes[s_route_count++] = route;
+    }
+    return err;
+}
+
+int web_route_count(void)
+{
+    return s_route_count;
+}
+
+const web_route_t *web_route_at(int index)
+{
+    return (index >= 0 && index < s_route_count) ? s_routes[index] : NULL;
+}
+
+esp_err_t web_route_stats_handler(httpd_req_t *req)
+{
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+
+    char buf[512];
+    json_writer_t w;
+    json_writer_init_http(&w, req, buf, sizeof(buf));
+    json_obj_begin(&w);
+    json_kv_int(&w, "workers", WEB_ASYNC_WORKERS);
+    json_kv_int(&w, "queue_len", WEB_ASYNC_QUEUE_LEN);
+    json_kv_uint(&w, "queued", s_job_queue ? uxQueueMessagesWaiting(s_job_queue) : 0);
+    json_kv_bool(&w, "alloc_check", WEB_ALLOC_CHECK);
+    json_kv_uint(&w, "arena_peak", web_session_arena_peak());
+    json_key(&w, "bucket_le_us");
+    json_arr_begin(&w);
+    for (int b = 0; b < METRICS_HIST_BUCKETS - 1; b++) {
+        json_uint(&w, metrics_hist_bounds_us[b]);
+    }
+    json_arr_end(&w);
+
+    json_key(&w, "routes");
+    json_arr_begin(&w);
+    for (int i = 0; i < s_route_count; i++) {
+        const web_route_t *route = s_routes[i];
+        uint32_t hist[METRICS_HIST_BUCKETS];
+        uint64_t sum_us, wait_sum_us;
+        uint32_t count = metrics_hist_read(&route->stats.latency, hist, &sum_us);
+        uint32_t wait_hist[METRICS_HIST_BUCKETS];
+        uint32_t waited = metrics_hist_read(&route->stats.wait, wait_hist, &wait_sum_us);
+
+        json_obj_begin(&w);
+        json_kv_str(&w, "uri", route->uri);
+        json_kv_bool(&w, "async", route->async);
+        json_kv_uint(&w, "count", count);
+        json_kv_uint(&w, "errors", metrics_counter_value(&route->stats.errors));
+        json_kv_uint(&w, "rejected", metrics_counter_value(&route->stats.rejected));
+#if WEB_ALLOC_CHECK
+        json_kv_uint(&w, "allocs", metrics_counter_value(&route->stats.allocs));
+#endif
+        json_kv_uint(&w, "avg_us", count ? sum_us / count : 0);
+        json_kv_uint(&w, "avg_wait_us", waited ? wait_sum_us / waited : 0);
+        json_key(&w, "hist");
+        json_arr_begin(&w);
+        for (int b = 0; b < METRICS_HIST_BUCKETS; b++) {
+            json_uint(&w, hist[b]);
+        }
+        json_arr_end(&w);
+        json_obj_end(&w);
+    }
+    json_arr_end(&w);
+    json_obj_end(&w);
+    return json_writer_send(&w);
+}
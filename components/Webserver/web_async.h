@@ -0,0 +1,61 @@
+#ifndef WEB_ASYNC_H
+#define WEB_ASYNC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_http_server.h"
+#include "metrics.h"
+
+// 异步工作线程数与排队深度：每个排队/执行中的请求都占着一个 socket，
+// 总数要小于 max_open_sockets，否则慢请求会把快接口也挤掉。
+// 精简看板一页同时请求 4 张 /spark.svg，排队深度按此留足，另一个客户端的慢请求也不会被 503；
+// 工作线程加排队共 6 个，至少留一个 socket 给推送连接和快接口
+#define WEB_ASYNC_WORKERS      2
+#define WEB_ASYNC_QUEUE_LEN    4
+#define WEB_ASYNC_STACK_SIZE   4096
+#define WEB_ASYNC_PRIORITY     4
+// data_process_task 固定在核 1，工作线程放在核 0，不抢采样任务的 CPU
+#define WEB_ASYNC_CORE         0
+
+// 单个接口的统计（按核心分槽的原子计数，httpd 任务与工作线程可同时记录）
+typedef struct {
+    metrics_hist_t latency;     // 处理耗时，次数即完成的请求数
+    metrics_hist_t wait;        // 排队等待（仅异步接口）
+    metrics_counter_t errors;   // 处理函数返回非 ESP_OK 的次数
+    metrics_counter_t rejected; // 排队已满返回 503 的次数（仅异步接口）
+    metrics_counter_t allocs;   // 处理期间的堆分配次数（仅开启 CONFIG_HOME_ALLOC_CHECK 时统计）
+} web_route_stats_t;
+
+// 路由表项：所有接口经由统一入口分发并计时，处理期间可使用会话内存池（请求结束后清空），
+// async 为 true 的接口交给工作线程执行，不占用 httpd 任务；
+// websocket 为 true 的是 WebSocket 接口，握手与每个数据帧各算一次调用；
+// 分发前按来源 IP 限流，control 为 true 的控制接口使用单独预留的额度
+typedef struct {
+    const char *uri;
+    httpd_method_t method;
+    esp_err_t (*handler)(httpd_req_t *req);
+    bool async;
+    bool control;
+    bool websocket;
+    const char *subprotocol;    // WebSocket 握手时可接受的子协议
+    web_route_stats_t stats;
+} web_route_t;
+
+// 创建请求队列和工作线程，须在注册异步接口前调用
+esp_err_t web_async_start(void);
+
+// 在工作线程中执行一个不对应 HTTP 请求的任务（如 WebSocket 上需要写 NVS 的命令），在 httpd 任务中调用；
+// 排队已满返回 ESP_ERR_NO_MEM，调用者自行回复忙。任务不计入路由统计
+esp_err_t web_async_submit(void (*fn)(void *arg), void *arg);
+
+// 注册一个路由表项（表项需静态存储，统计直接写在表项里）
+esp_err_t web_route_register(httpd_handle_t server, web_route_t *route);
+
+// 遍历已注册的路由（导出指标用）
+int web_route_count(void);
+const web_route_t *web_route_at(int index);
+
+// GET /diag/handlers：返回各接口的调用次数、耗时和排队情况
+esp_err_t web_route_stats_handler(httpd_req_t *req);
+
+#endif // WEB_ASYNC_H
@@ -0,0 +1,321 @@
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <sys/time.h>
+#include "esp_log.h"
+#include "nvs.h"
+#include "ap.h"
+#include "settings.h"
+#include "metrics.h"
+#include "trace.h"
+#include "json_writer.h"
+#include "json_reader.h"
+#include "web_session.h"
+#include "web_limit.h"
+#include "web_async.h"
+#include "ws_push.h"
+#include "web.h"
+#include "web_ctrl.h"
+
+static const char *TAG = "WEB_CTRL";
+
+// 网页对时是否完成
+bool time_sync_done = false;
+
+// WebSocket 回复消息的缓冲大小（放在会话内存池里）
+#define WEB_CTRL_REPLY_SIZE 128
+
+esp_err_t web_ctrl_sync_time(long timestamp)
+{
+    // 如果系统已经通过 NTP 获得了准确时间，就不再接受网页端的同步
+    if (g_is_ntp_synced) {
+        ESP_LOGI(TAG, "拒网页同步: 系统已连接网络并启用高质量 NTP 时间");
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (timestamp <= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    //设置系统时间
+    struct timeval tv = {
+        .tv_sec = (time_t)timestamp,
+        .tv_usec = 0
+    };
+    settimeofday(&tv, NULL);
+
+    //设置时区为中国标准时间
+    setenv("TZ", "CST-8", 1);
+    tzset();
+
+    time_sync_done = true;
+
+    //打印同步后的时间
+    time_t now = time(NULL);
+    struct tm timeinfo;
+    localtime_r(&now, &timeinfo);
+    char strftime_buf[64];
+    strftime(strftime_buf, sizeof(strftime_buf), "%c", &timeinfo);
+    ESP_LOGI(TAG, "系统时间同步为: %s", strftime_buf);
+    return ESP_OK;
+}
+
+esp_err_t web_ctrl_set_alarm(float threshold)
+{
+    // 交给设置服务：立即生效，NVS 写入由设置任务合并后延迟进行
+    esp_err_t err = settings_set_alarm_threshold(threshold);
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "收到新报警阈值: %.1f", settings_get_alarm_threshold());
+        ws_push_settings_changed();
+    }
+    return err;
+}
+
+esp_err_t web_ctrl_wifi_config(const char *ssid, const char *password, uint32_t *job)
+{
+    ESP_LOGI(TAG, "准备连接 -> SSID: %s", ssid);
+    // 保存到 NVS；保存失败时不开始连接，让客户端知道重启后账号不会保留
+    nvs_handle_t my_handle;
+    esp_err_t err = nvs_open("storage", NVS_READWRITE, &my_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "NVS 打开失败 (%s)，未保存 Wi-Fi 信息", esp_err_to_name(err));
+        return err;
+    }
+    err = nvs_set_str(my_handle, "wifi_ssid", ssid);
+    if (err == ESP_OK) {
+        err = nvs_set_str(my_handle, "wifi_pass", password);
+    }
+    if (err == ESP_OK) {
+        TRACE_BEGIN(TRACE_NVS_COMMIT);
+        err = nvs_commit(my_handle);
+        TRACE_END(TRACE_NVS_COMMIT);
+        METRICS_INC(err == ESP_OK ? METRIC_NVS_COMMITS : METRIC_NVS_COMMIT_ERRORS);
+    }
+    nvs_close(my_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "保存 Wi-Fi 信息失败 (%s)", esp_err_to_name(err));
+        return err;
+    }
+    ESP_LOGI(TAG, "Wi-Fi 信息已保存至 NVS");
+
+    // 连接在后台进行，不占用当前任务等待 IP；进度通过 /wifi_status 或 WebSocket 获取
+    *job = wifi_prov_start(ssid, password);
+    return ESP_OK;
+}
+
+// 请求字段表，HTTP 请求体与 WebSocket 请求消息共用
+const json_field_t web_ctrl_alarm_fields[WEB_CTRL_ALARM_FIELDS] = {
+    { "threshold", JSON_FIELD_FIXED1, true, offsetof(web_ctrl_alarm_args_t, threshold_x10),
+      SETTINGS_ALARM_MIN_X10, SETTINGS_ALARM_MAX_X10 },
+};
+
+const json_field_t web_ctrl_wifi_fields[WEB_CTRL_WIFI_FIELDS] = {
+    { "ssid",     JSON_FIELD_STR, true, offsetof(web_ctrl_wifi_args_t, ssid),     1, 32 },
+    { "password", JSON_FIELD_STR, true, offsetof(web_ctrl_wifi_args_t, password), 0, 64 },
+};
+
+// WebSocket 请求的信封：id 可省略（回复里为 0）
+typedef struct {
+    int32_t id;
+    const char *op;
+} web_ctrl_envelope_t;
+
+static const json_field_t s_envelope_fields[] = {
+    { "id", JSON_FIELD_INT, false, offsetof(web_ctrl_envelope_t, id), 0, INT32_MAX },
+    { "op", JSON_FIELD_STR, true,  offsetof(web_ctrl_envelope_t, op), 1, 16 },
+};
+
+typedef struct {
+    int32_t ts;
+} web_ctrl_time_args_t;
+
+static const json_field_t s_time_fields[] = {
+    { "ts", JSON_FIELD_INT, true, offsetof(web_ctrl_time_args_t, ts), 1, INT32_MAX },
+};
+
+static void reply_error(json_writer_t *w, const char *reason)
+{
+    json_kv_str(w, "status", "error");
+    json_kv_str(w, "reason", reason);
+}
+
+// 回复消息的开头，之后由调用者写入结果成员
+static void reply_begin(json_writer_t *w, char *buf, size_t size, int32_t id)
+{
+    json_writer_init_buf(w, buf, size);
+    json_obj_begin(w);
+    json_kv_int(w, "v", 2);
+    json_kv_str(w, "type", "reply");
+    json_kv_int(w, "id", id);
+}
+
+// WebSocket 上的配网请求：写 NVS 可能耗时数十毫秒，与 HTTP /wifi_config 一样交给异步工作线程，
+// 不占用 httpd 任务；工作线程写好回复后再切回 httpd 任务经发送队列送出。
+// 配网很少发生，只留一个槽位，上一个请求未完成时回 busy，不分配内存
+typedef struct {
+    httpd_handle_t hd;
+    int fd;
+    int32_t id;
+    char ssid[33];
+    char password[65];
+    char reply[WEB_CTRL_REPLY_SIZE];
+    int reply_len;
+} web_ctrl_wifi_job_t;
+
+static web_ctrl_wifi_job_t s_wifi_job;
+static atomic_bool s_wifi_job_busy = false;
+
+void web_ctrl_session_closed(int fd)
+{
+    // 与提交、回复都在 httpd 任务中执行，fd 不需要加锁
+    if (atomic_load(&s_wifi_job_busy) && s_wifi_job.fd == fd) {
+        s_wifi_job.fd = -1;
+    }
+}
+
+// httpd 任务：送出回复并释放槽位。发起请求的连接已关闭时 fd 为 -1，
+// 回复直接丢弃，不会发给复用了同一 fd 的新连接
+static void web_ctrl_wifi_reply_work(void *arg)
+{
+    web_ctrl_wifi_job_t *job = (web_ctrl_wifi_job_t *)arg;
+    if (job->fd >= 0 && job->reply_len > 0) {
+        esp_err_t err = ws_push_send_event(job->fd, job->reply, (size_t)job->reply_len);
+        if (err == ESP_ERR_NOT_FOUND) {
+            // 未订阅推送的连接没有发送队列，直接写帧
+            httpd_ws_frame_t frame = {
+                .type = HTTPD_WS_TYPE_TEXT,
+                .payload = (uint8_t *)job->reply,
+                .len = (size_t)job->reply_len,
+            };
+            err = httpd_ws_send_frame_async(job->hd, job->fd, &frame);
+        }
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "配网回复未送达 fd=%d", job->fd);
+        }
+    }
+    atomic_store(&s_wifi_job_busy, false);
+}
+
+// 工作线程：保存并开始连接，写好回复
+static void web_ctrl_wifi_work(void *arg)
+{
+    web_ctrl_wifi_job_t *job = (web_ctrl_wifi_job_t *)arg;
+    uint32_t prov_job;
+    esp_err_t err = web_ctrl_wifi_config(job->ssid, job->password, &prov_job);
+    // 密码不在内存中多留
+    memset(job->password, 0, sizeof(job->password));
+
+    json_writer_t w;
+    reply_begin(&w, job->reply, sizeof(job->reply), job->id);
+    if (err == ESP_OK) {
+        json_kv_str(&w, "status", "accepted");
+        json_kv_uint(&w, "job", prov_job);
+    } else {
+        reply_error(&w, "nvs");
+    }
+    json_obj_end(&w);
+    job->reply_len = json_writer_finish(&w);
+
+    if (httpd_queue_work(job->hd, web_ctrl_wifi_reply_work, job) != ESP_OK) {
+        atomic_store(&s_wifi_job_busy, false);
+    }
+}
+
+// 提交配网请求，成功时回复由工作线程稍后送出，返回 true
+static bool web_ctrl_wifi_submit(json_writer_t *w, httpd_req_t *req, int32_t id, const web_ctrl_wifi_args_t *args)
+{
+    if (atomic_exchange(&s_wifi_job_busy, true)) {
+        reply_error(w, "busy");
+        return false;
+    }
+    web_ctrl_wifi_job_t *job = &s_wifi_job;
+    job->hd = req->handle;
+    job->fd = httpd_req_to_sockfd(req);
+    job->id = id;
+    job->reply_len = 0;
+    snprintf(job->ssid, sizeof(job->ssid), "%s", args->ssid);
+    snprintf(job->password, sizeof(job->password), "%s", args->password);
+    if (web_async_submit(web_ctrl_wifi_work, job) != ESP_OK) {
+        memset(job->password, 0, sizeof(job->password));
+        atomic_store(&s_wifi_job_busy, false);
+        reply_error(w, "busy");
+        return false;
+    }
+    return true;
+}
+
+// 执行一条请求，把结果写成回复消息的成员；参数从同一组 token 中按各命令的字段表提取。
+// 返回 true 表示命令已交给工作线程，回复由它稍后送出
+static bool web_ctrl_dispatch(json_writer_t *w, httpd_req_t *req, int32_t id,
+                              char *msg, const json_tok_t *toks, int count, const char *op)
+{
+    if (strcmp(op, "sync_time") == 0) {
+        web_ctrl_time_args_t args;
+        esp_err_t err = json_extract(msg, toks, count, s_time_fields, 1, &args) == JSON_OK ?
+                        web_ctrl_sync_time(args.ts) : ESP_ERR_INVALID_ARG;
+        if (err == ESP_OK) {
+            json_kv_str(w, "status", "ok");
+        } else if (err == ESP_ERR_NOT_SUPPORTED) {
+            json_kv_str(w, "status", "ignored");
+            json_kv_str(w, "reason", "ntp");
+        } else {
+            reply_error(w, "invalid");
+        }
+    } else if (strcmp(op, "set_alarm") == 0) {
+        web_ctrl_alarm_args_t args;
+        int r = json_extract(msg, toks, count, web_ctrl_alarm_fields, WEB_CTRL_ALARM_FIELDS, &args);
+        if (r == JSON_ERR_RANGE) {
+            reply_error(w, "out_of_range");
+        } else if (r != JSON_OK) {
+            reply_error(w, "bad_request");
+        } else if (web_ctrl_set_alarm(args.threshold_x10 / 10.0f) == ESP_OK) {
+            json_kv_str(w, "status", "ok");
+        } else {
+            reply_error(w, "out_of_range");
+        }
+    } else if (strcmp(op, "wifi_config") == 0) {
+        web_ctrl_wifi_args_t args;
+        if (json_extract(msg, toks, count, web_ctrl_wifi_fields, WEB_CTRL_WIFI_FIELDS, &args) == JSON_OK) {
+            return web_ctrl_wifi_submit(w, req, id, &args);
+        }
+        reply_error(w, "bad_request");
+    } else {
+        reply_error(w, "unknown_op");
+    }
+    return false;
+}
+
+esp_err_t web_ctrl_ws_request(httpd_req_t *req, char *msg, size_t len)
+{
+    web_session_t *s = web_session_get(req);
+    char *reply = web_request_alloc(s, WEB_CTRL_REPLY_SIZE);
+    if (reply == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // 在接收缓冲上就地切分，token 放在栈上，不分配内存
+    json_tok_t toks[JSON_READER_MAX_TOKENS];
+    web_ctrl_envelope_t env = { 0 };
+    int count = json_parse(msg, len, toks, JSON_READER_MAX_TOKENS);
+    int r = count < 0 ? count : json_extract(msg, toks, count, s_envelope_fields, 2, &env);
+
+    json_writer_t w;
+    reply_begin(&w, reply, WEB_CTRL_REPLY_SIZE, env.id);
+    // 与 HTTP 控制接口共用同一个来源 IP 的控制额度
+    if (!web_limit_allow(req, true)) {
+        json_kv_str(&w, "status", "limited");
+    } else if (r != JSON_OK) {
+        reply_error(&w, "bad_request");
+    } else if (web_ctrl_dispatch(&w, req, env.id, msg, toks, count, env.op)) {
+        web_request_free(reply);
+        return ESP_OK;
+    }
+    json_obj_end(&w);
+
+    int out = json_writer_finish(&w);
+    esp_err_t err = out < 0 ? ESP_ERR_NO_MEM : ws_push_reply(req, reply, (size_t)out);
+    web_request_free(reply);
+    return err;
+}
@@ -0,0 +1,50 @@
+#ifndef WEB_CTRL_H
+#define WEB_CTRL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_http_server.h"
+#include "json_reader.h"
+
+// 控制命令：网页对时、设置报警阈值、配网。
+// HTTP 接口（/sync_time、/set_alarm、/wifi_config）与 WebSocket 上的请求/回复消息共用这里的实现
+
+// 用浏览器时间设置系统时钟：已由 NTP 对时返回 ESP_ERR_NOT_SUPPORTED（忽略网页时间），时间戳无效返回 ESP_ERR_INVALID_ARG
+esp_err_t web_ctrl_sync_time(long timestamp);
+
+// 设置报警阈值：数值无效（超出 -20 ~ 80 ℃）返回 ESP_ERR_INVALID_ARG；
+// 成功后立即推送给所有 WebSocket / SSE 客户端，不必等下一个采样周期
+esp_err_t web_ctrl_set_alarm(float threshold);
+
+// 保存 Wi-Fi 账号密码到 NVS 并在后台开始连接，job 返回配网任务编号（进度见 /wifi_status 或 prov 推送）；
+// 写 NVS 可能耗时，只在异步工作线程中调用。保存失败时返回 NVS 的错误且不开始连接
+esp_err_t web_ctrl_wifi_config(const char *ssid, const char *password, uint32_t *job);
+
+// 请求体字段表（json_reader），HTTP 接口与 WebSocket 请求共用，类型与范围在提取时校验
+typedef struct {
+    int32_t threshold_x10;      // 报警阈值，单位 0.1 ℃，超出设置服务的范围返回 JSON_ERR_RANGE
+} web_ctrl_alarm_args_t;
+
+typedef struct {
+    const char *ssid;           // 1 ~ 32 字节
+    const char *password;       // 0 ~ 64 字节
+} web_ctrl_wifi_args_t;
+
+#define WEB_CTRL_ALARM_FIELDS   1
+#define WEB_CTRL_WIFI_FIELDS    2
+extern const json_field_t web_ctrl_alarm_fields[WEB_CTRL_ALARM_FIELDS];
+extern const json_field_t web_ctrl_wifi_fields[WEB_CTRL_WIFI_FIELDS];
+
+// WebSocket 请求消息：{"id": 7, "op": "set_alarm", "threshold": 31.5}
+//   op 为 sync_time（"ts": Unix 秒）、set_alarm（"threshold"）、wifi_config（"ssid"、"password"）
+// 回复与对应 HTTP 接口的响应体相同，另加 {"v": 2, "type": "reply", "id": 请求的 id}，经该连接的发送队列送出；
+// 按来源 IP 扣控制接口的令牌，超额回 {"status": "limited"}。
+// wifi_config 交给异步工作线程执行，回复稍后送出；保存失败回 {"status": "error", "reason": "nvs"}，
+// 上一个配网请求未完成或工作队列已满回 {"status": "error", "reason": "busy"}。
+// msg 为会话接收缓冲中的文本（len 字节），解析时就地改写
+esp_err_t web_ctrl_ws_request(httpd_req_t *req, char *msg, size_t len);
+
+// 连接关闭时调用（httpd 的 close_fn）：该连接上还在执行的配网请求的回复不再发送
+void web_ctrl_session_closed(int fd);
+
+#endif // WEB_CTRL_H
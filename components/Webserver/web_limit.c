@@ -0,0 +1,184 @@
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "lwip/sockets.h"
+#include "sdkconfig.h"
+#include "metrics.h"
+#include "web_limit.h"
+
+static const char *TAG = "WEB_LIMIT";
+
+// 令牌桶：令牌数放大 1000 倍存成整数，按距上次取用的时间补充
+typedef struct {
+    uint32_t milli;
+    int64_t last_us;
+} web_bucket_t;
+
+typedef struct {
+    bool used;
+    uint8_t addr[16];           // IPv6 地址，IPv4 存为 ::ffff:a.b.c.d
+    int64_t last_seen_us;
+    web_bucket_t conn;
+    web_bucket_t req;
+    web_bucket_t ctrl;
+    uint32_t requests;
+    uint32_t throttled;
+    uint32_t conns;
+    uint32_t conns_rejected;
+    bool exempt;                // 在 CONFIG_HOME_RATE_LIMIT_EXEMPT 中，不限流
+} web_limit_client_t;
+
+static web_limit_client_t s_clients[WEB_LIMIT_MAX_CLIENTS];
+
+// 来源是否在免限流列表中（逗号分隔的 IPv4 地址），只在新建表项时查一次
+static bool addr_exempt(const uint8_t addr[16])
+{
+    static const uint8_t v4_prefix[12] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff };
+    const char *p = CONFIG_HOME_RATE_LIMIT_EXEMPT;
+    if (*p == '\0' || memcmp(addr, v4_prefix, sizeof(v4_prefix)) != 0) {
+        return false;
+    }
+    while (*p != '\0') {
+        char ip[16];
+        size_t n = strcspn(p, ", ");
+        struct in_addr a;
+        if (n > 0 && n < sizeof(ip)) {
+            memcpy(ip, p, n);
+            ip[n] = '\0';
+            if (inet_pton(AF_INET, ip, &a) == 1 && memcmp(&a, addr + 12, 4) == 0) {
+                return true;
+            }
+        }
+        p += n;
+        p += strspn(p, ", ");
+    }
+    return false;
+}
+
+static bool bucket_take(web_bucket_t *b, uint32_t rate, uint32_t burst, int64_t now)
+{
+    uint32_t cap = burst * 1000;
+    int64_t refill = (now - b->last_us) * rate / 1000;
+    b->milli = (refill >= (int64_t)(cap - b->milli)) ? cap : b->milli + (uint32_t)refill;
+    b->last_us = now;
+    if (b->milli < 1000) {
+        return false;
+    }
+    b->milli -= 1000;
+    return true;
+}
+
+// 取 socket 对端地址，统一成 16 字节
+static bool peer_addr(int sockfd, uint8_t addr[16])
+{
+    struct sockaddr_storage ss;
+    socklen_t len = sizeof(ss);
+    if (getpeername(sockfd, (struct sockaddr *)&ss, &len) != 0) {
+        return false;
+    }
+    if (ss.ss_family == AF_INET) {
+        memset(addr, 0, 10);
+        addr[10] = 0xff;
+        addr[11] = 0xff;
+        memcpy(addr + 12, &((struct sockaddr_in *)&ss)->sin_addr, 4);
+        return true;
+    }
+#if CONFIG_LWIP_IPV6
+    if (ss.ss_family == AF_INET6) {
+        memcpy(addr, &((struct sockaddr_in6 *)&ss)->sin6_addr, 16);
+        return true;
+    }
+#endif
+    return false;
+}
+
+// 查找来源对应的表项，没有则占用空位或替换最久未出现的（新来源的桶是满的）
+static web_limit_client_t *client_get(const uint8_t addr[16], int64_t now)
+{
+    web_limit_client_t *victim = &s_clients[0];
+    for (int i = 0; i < WEB_LIMIT_MAX_CLIENTS; i++) {
+        web_limit_client_t *c = &s_clients[i];
+        if (c->used && memcmp(c->addr, addr, 16) == 0) {
+            c->last_seen_us = now;
+            return c;
+        }
+        if (victim->used && (!c->used || c->last_seen_us < victim->last_seen_us)) {
+            victim = c;
+        }
+    }
+
+    memset(victim, 0, sizeof(*victim));
+    victim->used = true;
+    memcpy(victim->addr, addr, 16);
+    victim->last_seen_us = now;
+    victim->conn = (web_bucket_t){ .milli = WEB_LIMIT_CONN_BURST * 1000, .last_us = now };
+    victim->req = (web_bucket_t){ .milli = WEB_LIMIT_REQ_BURST * 1000, .last_us = now };
+    victim->ctrl = (web_bucket_t){ .milli = WEB_LIMIT_CTRL_BURST * 1000, .last_us = now };
+    victim->exempt = addr_exempt(addr);
+    return victim;
+}
+
+esp_err_t web_limit_on_open(httpd_handle_t hd, int sockfd)
+{
+    uint8_t addr[16];
+    if (!peer_addr(sockfd, addr)) {
+        return ESP_OK;
+    }
+    int64_t now = esp_timer_get_time();
+    web_limit_client_t *c = client_get(addr, now);
+    if (!c->exempt && !bucket_take(&c->conn, WEB_LIMIT_CONN_RATE, WEB_LIMIT_CONN_BURST, now)) {
+        c->conns_rejected++;
+        METRICS_INC(METRIC_HTTP_CONN_REJECTED);
+        ESP_LOGD(TAG, "fd=%d 新建连接过于频繁，关闭", sockfd);
+        return ESP_FAIL;
+    }
+    c->conns++;
+    return ESP_OK;
+}
+
+bool web_limit_allow(httpd_req_t *req, bool control)
+{
+    uint8_t addr[16];
+    if (!peer_addr(httpd_req_to_sockfd(req), addr)) {
+        return true;
+    }
+    int64_t now = esp_timer_get_time();
+    web_limit_client_t *c = client_get(addr, now);
+    bool ok = c->exempt ||
+              (control ? bucket_take(&c->ctrl, WEB_LIMIT_CTRL_RATE, WEB_LIMIT_CTRL_BURST, now)
+                       : bucket_take(&c->req, WEB_LIMIT_REQ_RATE, WEB_LIMIT_REQ_BURST, now));
+    if (ok) {
+        c->requests++;
+    } else {
+        c->throttled++;
+        METRICS_INC(METRIC_HTTP_THROTTLED);
+    }
+    return ok;
+}
+
+esp_err_t web_limit_reject(httpd_req_t *req)
+{
+    httpd_resp_set_status(req, "429 Too Many Requests");
+    httpd_resp_set_hdr(req, "Retry-After", "1");
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_sendstr(req, "{\"status\":\"limited\"}");
+}
+
+bool web_limit_client_at(int index, web_limit_client_info_t *out)
+{
+    if (index < 0 || index >= WEB_LIMIT_MAX_CLIENTS || !s_clients[index].used) {
+        return false;
+    }
+    const web_limit_client_t *c = &s_clients[index];
+    static const uint8_t v4_prefix[12] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff };
+    if (memcmp(c->addr, v4_prefix, sizeof(v4_prefix)) == 0) {
+        inet_ntop(AF_INET, c->addr + 12, out->ip, sizeof(out->ip));
+    } else {
+        inet_ntop(AF_INET6, c->addr, out->ip, sizeof(out->ip));
+    }
+    out->requests = c->requests;
+    out->throttled = c->throttled;
+    out->conns = c->conns;
+    out->conns_rejected = c->conns_rejected;
+    return true;
+}
@@ -0,0 +1,48 @@
+#ifndef WEB_LIMIT_H
+#define WEB_LIMIT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_http_server.h"
+
+// 按来源 IP 限流：每个客户端三个令牌桶（新建连接、普通请求、控制接口），
+// 普通接口刷得再凶也不会耗尽控制接口的额度；超额的请求回一个 429，超额的连接直接关闭。
+// 表和桶只在 httpd 任务中访问（open_fn、路由分发、指标导出都在 httpd 任务里），不需要加锁。
+// CONFIG_HOME_RATE_LIMIT_EXEMPT 中列出的 IPv4 地址（压测机）不扣令牌，仍照常计数
+
+// 同时跟踪的来源 IP 数，满了替换最久未出现的
+#define WEB_LIMIT_MAX_CLIENTS   12
+
+// 令牌桶参数：每秒补充的令牌数与桶容量（允许的突发）
+// 首页打开时会并发请求页面、资源与 /api/*，突发要留够
+#define WEB_LIMIT_REQ_RATE      10
+#define WEB_LIMIT_REQ_BURST     40
+// WebSocket 断线重连风暴主要体现为新建连接
+#define WEB_LIMIT_CONN_RATE     1
+#define WEB_LIMIT_CONN_BURST    10
+// 控制接口（设置阈值、配网及其进度查询、对时）单独预留的额度，配网期间页面每秒查询一次进度
+#define WEB_LIMIT_CTRL_RATE     2
+#define WEB_LIMIT_CTRL_BURST    10
+
+// 单个来源的统计，供 /metrics 导出
+typedef struct {
+    char ip[40];
+    uint32_t requests;          // 放行的请求
+    uint32_t throttled;         // 超额回 429 的请求
+    uint32_t conns;             // 放行的新连接
+    uint32_t conns_rejected;    // 超额被关闭的新连接
+} web_limit_client_info_t;
+
+// httpd 的 open_fn：新连接先扣连接令牌，超额返回 ESP_FAIL，httpd 随即关闭该 socket
+esp_err_t web_limit_on_open(httpd_handle_t hd, int sockfd);
+
+// 路由分发前调用：扣请求令牌（control 为 true 时扣控制接口的令牌），超额返回 false
+bool web_limit_allow(httpd_req_t *req, bool control);
+
+// 回一个 429 Too Many Requests（带 Retry-After）
+esp_err_t web_limit_reject(httpd_req_t *req);
+
+// 遍历已跟踪的来源（导出指标用），index 越界返回 false
+bool web_limit_client_at(int index, web_limit_client_info_t *out);
+
+#endif // WEB_LIMIT_H
@@ -0,0 +1,130 @@
+#include <string.h>
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "lwip/sockets.h"
+#include "trace.h"
+#include "web_sendq.h"
+
+uint8_t *web_sendq_alloc_pool(int n)
+{
+    uint8_t *pool = heap_caps_calloc(n, WEB_SENDQ_BYTES, MALLOC_CAP_SPIRAM);
+    if (pool == NULL) {
+        pool = heap_caps_calloc(n, WEB_SENDQ_BYTES, MALLOC_CAP_DEFAULT);
+    }
+    return pool;
+}
+
+void web_sendq_reset(web_sendq_t *q, uint8_t *buf)
+{
+    q->buf = buf;
+    q->count = 0;
+    q->bytes = 0;
+    q->sent = 0;
+}
+
+bool web_sendq_room(const web_sendq_t *q, size_t len)
+{
+    return q->buf != NULL && q->count < WEB_SENDQ_FRAMES && q->bytes + len <= WEB_SENDQ_BYTES;
+}
+
+// 从队列中移除第 i 帧
+static void web_sendq_remove(web_sendq_t *q, int i)
+{
+    uint16_t off = 0;
+    for (int k = 0; k < i; k++) {
+        off += q->f[k].len;
+    }
+    uint16_t len = q->f[i].len;
+    memmove(q->buf + off, q->buf + off + len, q->bytes - off - len);
+    memmove(&q->f[i], &q->f[i + 1], (q->count - i - 1) * sizeof(web_sendq_frame_t));
+    q->count--;
+    q->bytes -= len;
+}
+
+bool web_sendq_drop(web_sendq_t *q, uint8_t kind)
+{
+    bool dropped = false;
+    // 队首帧已写出一部分时必须写完，否则对端收到的字节流就断了
+    int first = q->sent > 0 ? 1 : 0;
+    for (int i = q->count - 1; i >= first; i--) {
+        if (q->f[i].kind == kind) {
+            web_sendq_remove(q, i);
+            dropped = true;
+        }
+    }
+    return dropped;
+}
+
+esp_err_t web_sendq_push(web_sendq_t *q, const void *head, size_t head_len,
+                         const void *payload, size_t len, const void *tail, size_t tail_len, uint8_t kind)
+{
+    size_t total = head_len + len + tail_len;
+    if (!web_sendq_room(q, total) && kind != WEB_SENDQ_DIAG) {
+        web_sendq_drop(q, WEB_SENDQ_DIAG);
+    }
+    if (!web_sendq_room(q, total)) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (q->count == 0) {
+        q->progress_us = esp_timer_get_time();
+    }
+    uint8_t *p = q->buf + q->bytes;
+    if (head_len > 0) {
+        memcpy(p, head, head_len);
+    }
+    memcpy(p + head_len, payload, len);
+    if (tail_len > 0) {
+        memcpy(p + head_len + len, tail, tail_len);
+    }
+    q->f[q->count++] = (web_sendq_frame_t){ .len = (uint16_t)total, .kind = kind };
+    q->bytes += total;
+    return ESP_OK;
+}
+
+esp_err_t web_sendq_drain(web_sendq_t *q, httpd_handle_t hd, int fd, int64_t now,
+                          uint32_t *frames, uint32_t *bytes)
+{
+    while (q->count > 0) {
+        uint16_t len = q->f[0].len;
+        TRACE_BEGIN(TRACE_WS_SEND);
+        int n = httpd_socket_send(hd, fd, (const char *)q->buf + q->sent, len - q->sent, MSG_DONTWAIT);
+        TRACE_END(TRACE_WS_SEND);
+        if (n == HTTPD_SOCK_ERR_TIMEOUT || n == 0) {
+            break; // 发送缓冲已满（EAGAIN），留到下次
+        }
+        if (n < 0) {
+            return ESP_FAIL;
+        }
+        q->progress_us = now;
+        q->sent += n;
+        if (bytes != NULL) {
+            *bytes += n;
+        }
+        if (q->sent < len) {
+            break; // 只写进去一部分，发送缓冲已满
+        }
+        q->sent = 0;
+        web_sendq_remove(q, 0);
+        if (frames != NULL) {
+            (*frames)++;
+        }
+    }
+    if (q->count > 0 && now - q->progress_us > (int64_t)WEB_SENDQ_STALL_MS * 1000) {
+        return ESP_ERR_TIMEOUT;
+    }
+    return ESP_OK;
+}
+
+size_t web_sendq_ws_header(uint8_t *hdr, httpd_ws_type_t type, size_t len)
+{
+    hdr[0] = 0x80 | (uint8_t)type;
+    if (len < 126) {
+        hdr[1] = (uint8_t)len;
+        return 2;
+    }
+    // 队列中的帧不超过 WEB_SENDQ_BYTES，16 位长度足够
+    hdr[1] = 126;
+    hdr[2] = (uint8_t)(len >> 8);
+    hdr[3] = (uint8_t)len;
+    return 4;
+}
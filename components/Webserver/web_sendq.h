@@ -0,0 +1,61 @@
+#ifndef WEB_SENDQ_H
+#define WEB_SENDQ_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+// 推送连接（WebSocket、SSE）共用的发送队列：帧连同协议头（WebSocket 帧头 / HTTP chunk 头尾）
+// 按顺序复制进该连接的队列缓冲，再以 MSG_DONTWAIT 写给 socket，写多少算多少，
+// 剩下的部分留在队列里等发送缓冲腾出空间后续写，httpd 任务永远不会阻塞在慢客户端上。
+// 只在 httpd 任务中使用；同一个 socket 上的其他输出也必须经过队列，否则会插进写了一半的帧中间
+#define WEB_SENDQ_FRAMES    8
+#define WEB_SENDQ_BYTES     4096
+// 积压期间持续这么久没有写出任何字节的连接视为卡死
+#define WEB_SENDQ_STALL_MS  15000
+
+// 帧类别：DATA（整帧数据、快照 / 增量）与 DIAG（诊断、心跳）可被更新的同类帧取代，EVENT 必须送达
+enum { WEB_SENDQ_DATA, WEB_SENDQ_DIAG, WEB_SENDQ_EVENT };
+
+typedef struct {
+    uint16_t len;           // 含协议头尾
+    uint8_t kind;           // WEB_SENDQ_*
+} web_sendq_frame_t;
+
+typedef struct {
+    uint8_t *buf;           // WEB_SENDQ_BYTES 字节，取自 web_sendq_alloc_pool 分配的池
+    web_sendq_frame_t f[WEB_SENDQ_FRAMES];
+    uint8_t count;
+    uint16_t bytes;
+    uint16_t sent;          // 队首帧已写出的字节数，写了一半的帧不会被取代
+    int64_t progress_us;    // 队列非空期间最近一次写出字节（或开始积压）的时间
+} web_sendq_t;
+
+// 一次性分配 n 个队列的缓冲（优先 PSRAM），失败返回 NULL
+uint8_t *web_sendq_alloc_pool(int n);
+
+// 绑定缓冲并清空队列（新连接或连接关闭时）
+void web_sendq_reset(web_sendq_t *q, uint8_t *buf);
+
+// 剩余空间是否放得下 len 字节（含协议头尾）的一帧
+bool web_sendq_room(const web_sendq_t *q, size_t len);
+
+// 追加一帧：head + payload + tail 依次复制进队列，不发送；放不下时先丢弃可取代的诊断帧，
+// 仍放不下返回 ESP_ERR_NO_MEM（客户端落后太多，调用者应断开它）
+esp_err_t web_sendq_push(web_sendq_t *q, const void *head, size_t head_len,
+                         const void *payload, size_t len, const void *tail, size_t tail_len, uint8_t kind);
+
+// 丢弃队列中尚未开始发送的某类帧，返回是否丢弃了
+bool web_sendq_drop(web_sendq_t *q, uint8_t kind);
+
+// 尽量写出队列内容，直到清空或发送缓冲写满；frames 累加写完的帧数，bytes 累加写出的字节数（可为 NULL）。
+// socket 出错返回 ESP_FAIL，积压超过 WEB_SENDQ_STALL_MS 没有进展返回 ESP_ERR_TIMEOUT，调用者应断开连接
+esp_err_t web_sendq_drain(web_sendq_t *q, httpd_handle_t hd, int fd, int64_t now,
+                          uint32_t *frames, uint32_t *bytes);
+
+// WebSocket 服务端帧头（不加掩码，FIN=1），返回头长度
+size_t web_sendq_ws_header(uint8_t *hdr, httpd_ws_type_t type, size_t len);
+
+#endif // WEB_SENDQ_H
@@ -0,0 +1,223 @@
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "cJSON.h"
+#include "web_session.h"
+
+static const char *TAG = "WEB_SESSION";
+
+// 会执行请求处理函数的任务：httpd 任务与异步工作线程，留一个余量
+#define WEB_TASK_SLOTS 4
+
+// 单个任务的请求上下文
+typedef struct {
+    TaskHandle_t task;
+    web_session_t *active;      // 当前请求所属会话，cJSON 从它的内存池分配
+    volatile uint32_t allocs;   // 该任务的堆分配次数（由堆钩子累加）
+} web_task_ctx_t;
+
+static web_session_t *s_pool = NULL;
+
+// 槽位只增不减：登记后 task 字段不再改变，堆钩子里可以不加锁直接查找
+static web_task_ctx_t s_tasks[WEB_TASK_SLOTS];
+static portMUX_TYPE s_task_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static web_task_ctx_t *task_ctx_find(TaskHandle_t task)
+{
+    for (int i = 0; i < WEB_TASK_SLOTS; i++) {
+        if (s_tasks[i].task == task) {
+            return &s_tasks[i];
+        }
+    }
+    return NULL;
+}
+
+// 查找当前任务的上下文，首次调用时登记；槽位用完返回 NULL
+static web_task_ctx_t *task_ctx_get(void)
+{
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    web_task_ctx_t *ctx = task_ctx_find(task);
+    if (ctx != NULL) {
+        return ctx;
+    }
+    taskENTER_CRITICAL(&s_task_lock);
+    for (int i = 0; i < WEB_TASK_SLOTS; i++) {
+        if (s_tasks[i].task == NULL) {
+            s_tasks[i].task = task;
+            ctx = &s_tasks[i];
+            break;
+        }
+    }
+    taskEXIT_CRITICAL(&s_task_lock);
+    return ctx;
+}
+
+#if WEB_ALLOC_CHECK
+// 堆钩子（CONFIG_HEAP_USE_HOOKS）：每次分配成功后由堆调用，只给登记过的任务计数
+// 可能在关闭 cache 时被调用，必须放在 IRAM 且不调用其他 flash 中的函数
+void IRAM_ATTR esp_heap_trace_alloc_hook(void *ptr, size_t size, uint32_t caps)
+{
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    for (int i = 0; i < WEB_TASK_SLOTS; i++) {
+        if (s_tasks[i].task == task) {
+            s_tasks[i].allocs++;
+            return;
+        }
+    }
+}
+
+void IRAM_ATTR esp_heap_trace_free_hook(void *ptr)
+{
+}
+#endif
+
+static bool in_pool(const void *ptr)
+{
+    return s_pool != NULL && (const uint8_t *)ptr >= (const uint8_t *)s_pool &&
+           (const uint8_t *)ptr < (const uint8_t *)(s_pool + WEB_SESSION_MAX);
+}
+
+// cJSON 分配：请求处理中优先用会话内存池，池满或不在请求中时退回堆
+static void *web_cjson_malloc(size_t size)
+{
+    web_task_ctx_t *ctx = task_ctx_find(xTaskGetCurrentTaskHandle());
+    if (ctx != NULL && ctx->active != NULL) {
+        void *p = web_arena_alloc(ctx->active, size);
+        if (p != NULL) {
+            return p;
+        }
+    }
+    return malloc(size);
+}
+
+// 内存池里的块随请求结束整体回收，这里只释放堆上的
+static void web_cjson_free(void *ptr)
+{
+    web_request_free(ptr);
+}
+
+esp_err_t web_session_init(void)
+{
+    if (s_pool != NULL) {
+        return ESP_OK;
+    }
+    s_pool = heap_caps_calloc(WEB_SESSION_MAX, sizeof(web_session_t), MALLOC_CAP_SPIRAM);
+    if (s_pool == NULL) {
+        s_pool = heap_caps_calloc(WEB_SESSION_MAX, sizeof(web_session_t), MALLOC_CAP_DEFAULT);
+    }
+    if (s_pool == NULL) {
+        ESP_LOGE(TAG, "会话缓冲池分配失败");
+        return ESP_ERR_NO_MEM;
+    }
+
+    cJSON_Hooks hooks = {
+        .malloc_fn = web_cjson_malloc,
+        .free_fn = web_cjson_free,
+    };
+    cJSON_InitHooks(&hooks);
+    ESP_LOGI(TAG, "会话缓冲池 %d x %u 字节", WEB_SESSION_MAX, (unsigned)sizeof(web_session_t));
+    return ESP_OK;
+}
+
+// httpd 关闭会话时调用，把缓冲归还到池中
+static void web_session_release(void *ctx)
+{
+    web_session_t *s = (web_session_t *)ctx;
+    s->arena_used = 0;
+    s->in_use = false;
+}
+
+web_session_t *web_session_get(httpd_req_t *req)
+{
+    if (req->sess_ctx != NULL) {
+        return (web_session_t *)req->sess_ctx;
+    }
+    if (s_pool == NULL) {
+        return NULL;
+    }
+    for (int i = 0; i < WEB_SESSION_MAX; i++) {
+        web_session_t *s = &s_pool[i];
+        if (!s->in_use) {
+            s->in_use = true;
+            s->arena_used = 0;
+            req->sess_ctx = s;
+            req->free_ctx = web_session_release;
+            return s;
+        }
+    }
+    ESP_LOGW(TAG, "会话缓冲池已用完");
+    return NULL;
+}
+
+void *web_arena_alloc(web_session_t *s, size_t size)
+{
+    if (s == NULL) {
+        return NULL;
+    }
+    size_t offset = (s->arena_used + 7) & ~(size_t)7;
+    if (offset + size > WEB_SESSION_ARENA_SIZE) {
+        return NULL;
+    }
+    s->arena_used = offset + size;
+    if (s->arena_used > s->arena_peak) {
+        s->arena_peak = s->arena_used;
+    }
+    return s->arena + offset;
+}
+
+void *web_request_alloc(web_session_t *s, size_t size)
+{
+    void *p = web_arena_alloc(s, size);
+    return p != NULL ? p : malloc(size);
+}
+
+void web_request_free(void *ptr)
+{
+    if (!in_pool(ptr)) {
+        free(ptr);
+    }
+}
+
+void web_request_begin(web_session_t *s)
+{
+    web_task_ctx_t *ctx = task_ctx_get();
+    if (ctx != NULL) {
+        ctx->active = s;
+    }
+}
+
+void web_request_end(web_session_t *s)
+{
+    web_task_ctx_t *ctx = task_ctx_get();
+    if (ctx != NULL) {
+        ctx->active = NULL;
+    }
+    if (s != NULL) {
+        s->arena_used = 0;
+    }
+}
+
+uint32_t web_alloc_count(void)
+{
+#if WEB_ALLOC_CHECK
+    web_task_ctx_t *ctx = task_ctx_get();
+    return ctx != NULL ? ctx->allocs : 0;
+#else
+    return 0;
+#endif
+}
+
+uint32_t web_session_arena_peak(void)
+{
+    uint32_t peak = 0;
+    for (int i = 0; s_pool != NULL && i < WEB_SESSION_MAX; i++) {
+        if (s_pool[i].arena_peak > peak) {
+            peak = s_pool[i].arena_peak;
+        }
+    }
+    return peak;
+}
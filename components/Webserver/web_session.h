@@ -0,0 +1,60 @@
+#ifndef WEB_SESSION_H
+#define WEB_SESSION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_http_server.h"
+#include "sdkconfig.h"
+
+// 是否统计请求路径上的堆分配（menuconfig → Home web server）
+#if CONFIG_HOME_ALLOC_CHECK
+#define WEB_ALLOC_CHECK 1
+#else
+#define WEB_ALLOC_CHECK 0
+#endif
+
+// 会话缓冲池大小，与 httpd 的 max_open_sockets 一致：每个打开的 socket 最多占一个
+#define WEB_SESSION_MAX         7
+// 接收缓冲：WebSocket 文本命令、POST 正文
+#define WEB_SESSION_RX_SIZE     256
+// 请求级内存池：cJSON 节点、WebSocket 回复帧等，每个请求处理完后整体清空
+#define WEB_SESSION_ARENA_SIZE  2560
+
+// 每个会话预分配的缓冲，启动时一次性从 PSRAM（没有则内部 RAM）分配，之后不再 malloc
+typedef struct {
+    char rx[WEB_SESSION_RX_SIZE];
+    uint8_t arena[WEB_SESSION_ARENA_SIZE] __attribute__((aligned(8)));
+    size_t arena_used;
+    uint32_t arena_peak;    // 单个请求用掉的最大字节数（调整 ARENA_SIZE 的依据）
+    bool in_use;
+} web_session_t;
+
+// 分配会话缓冲池，并让 cJSON 的内存分配走当前请求的内存池，须在 httpd 启动前调用
+esp_err_t web_session_init(void);
+
+// 取得请求所属会话的缓冲：首次使用时从池中取一个绑定到 req->sess_ctx，会话关闭时自动归还
+// 只在 httpd 任务中调用；池已用完时返回 NULL，调用者应退回到堆分配
+web_session_t *web_session_get(httpd_req_t *req);
+
+// 从会话内存池分配（8 字节对齐），空间不足返回 NULL
+void *web_arena_alloc(web_session_t *s, size_t size);
+
+// 请求内的临时缓冲：优先用会话内存池，没有会话或池满时退回堆；
+// 用 web_request_free 释放（池里的块什么也不做，随请求结束回收）
+void *web_request_alloc(web_session_t *s, size_t size);
+void web_request_free(void *ptr);
+
+// 请求开始：把会话内存池设为当前任务的 cJSON 分配来源（s 可以为 NULL）
+void web_request_begin(web_session_t *s);
+// 请求结束：清空内存池，恢复 cJSON 使用堆
+void web_request_end(web_session_t *s);
+
+// 当前任务累计的堆分配次数：两次读数之差即一段代码中的 malloc 次数
+// 需开启 CONFIG_HOME_ALLOC_CHECK（通过堆钩子计数），未开启时恒为 0
+uint32_t web_alloc_count(void);
+
+// 各会话单个请求用掉内存池的最大字节数
+uint32_t web_session_arena_peak(void);
+
+#endif // WEB_SESSION_H
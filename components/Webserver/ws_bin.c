@@ -0,0 +1,91 @@
+#include <math.h>
+#include <string.h>
+#include "data_process.h"
+#include "settings.h"
+#include "data_json.h"
+#include "http_cache.h"
+#include "ws_bin.h"
+
+// 浮点转放大 10 倍的定点整数（四舍五入）
+static int16_t to_x10(float v)
+{
+    return (int16_t)lroundf(v * 10.0f);
+}
+
+static uint8_t *put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)(v & 0xff);
+    p[1] = (uint8_t)(v >> 8);
+    return p + 2;
+}
+
+static uint8_t *put_u32(uint8_t *p, uint32_t v)
+{
+    p = put_u16(p, (uint16_t)(v & 0xffff));
+    return put_u16(p, (uint16_t)(v >> 16));
+}
+
+int ws_bin_encode(uint8_t *buf, size_t size, uint8_t type, uint32_t seq, uint32_t fields)
+{
+    if (size < WS_BIN_MAX_FRAME) {
+        return -1;
+    }
+
+    uint8_t *p = buf;
+    *p++ = WS_BIN_VERSION;
+    *p++ = type;
+    *p++ = (uint8_t)(fields & (DATA_JSON_ALL | DATA_JSON_SAMPLE));
+    *p++ = 0;
+    p = put_u32(p, seq);
+
+    if (fields & DATA_JSON_LIVE) {
+        // 实时值本来就是整数 + 一位小数，直接拼成定点数
+        p = put_u16(p, (uint16_t)(get_temperature_int() * 10 + get_temperature_dec()));
+        p = put_u16(p, (uint16_t)(get_humidity_int() * 10 + get_humidity_dec()));
+    }
+
+    if (fields & DATA_JSON_TODAY) {
+        float max_t, min_t, max_h, min_h;
+        get_today_stats(&max_t, &min_t, &max_h, &min_h);
+        p = put_u16(p, (uint16_t)to_x10(max_t));
+        p = put_u16(p, (uint16_t)to_x10(min_t));
+        p = put_u16(p, (uint16_t)to_x10(max_h));
+        p = put_u16(p, (uint16_t)to_x10(min_h));
+    }
+
+    if (fields & DATA_JSON_ALARM) {
+        p = put_u16(p, (uint16_t)settings_get_alarm_x10());
+    }
+
+    if (fields & DATA_JSON_HISTORY) {
+        DailyData history[7];
+        get_weekly_history(history);
+
+        uint8_t *valid_mask = p++;
+        *valid_mask = 0;
+        for (int i = 0; i < 7; i++) {
+            if (history[i].valid) {
+                *valid_mask |= (uint8_t)(1u << i);
+                *p++ = (uint8_t)history[i].weekday;
+                p = put_u16(p, (uint16_t)to_x10(history[i].max_temp));
+                p = put_u16(p, (uint16_t)to_x10(history[i].min_temp));
+                p = put_u16(p, (uint16_t)to_x10(history[i].max_hum));
+                p = put_u16(p, (uint16_t)to_x10(history[i].min_hum));
+            } else {
+                // 无效的天同样占位，保证布局固定
+                memset(p, 0, 9);
+                p += 9;
+            }
+        }
+    }
+
+    if (fields & DATA_JSON_SAMPLE) {
+        sample_record_t rec = { 0 };
+        get_latest_sample(&rec);
+        p = put_u32(p, rec.seq);
+        p = put_u32(p, rec.ts);
+        p = put_u32(p, http_cache_boot_id());
+    }
+
+    return (int)(p - buf);
+}
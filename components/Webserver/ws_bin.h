@@ -0,0 +1,27 @@
+#ifndef WS_BIN_H
+#define WS_BIN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 二进制推送子协议名，通过 Sec-WebSocket-Protocol 协商
+#define WS_BIN_SUBPROTOCOL "th-bin.v1"
+
+// 帧格式（全部小端，温湿度均为放大 10 倍的定点整数）：
+//   头部 8 字节：u8 版本(1) | u8 类型(1=快照 2=增量) | u8 字段掩码(DATA_JSON_*) | u8 保留 | u32 消息序号
+//   按掩码位从低到高依次追加：
+//   LIVE    4 字节：i16 温度 | u16 湿度
+//   TODAY   8 字节：i16 最高温 | i16 最低温 | u16 最高湿 | u16 最低湿
+//   ALARM   2 字节：i16 报警阈值
+//   HISTORY 64 字节：u8 有效位图(bit i 对应 i+1 天前) | 7 × (u8 星期 | i16 最高温 | i16 最低温 | u16 最高湿 | u16 最低湿)
+//   SAMPLE  12 字节：u32 最新样本序号 | u32 设备时间 | u32 启动 ID（排在最后，只认前四组的解码器照常工作；
+//           启动 ID 与序号拼成续传令牌，见 data_json.h）
+#define WS_BIN_VERSION      1
+#define WS_BIN_TYPE_SNAP    1
+#define WS_BIN_TYPE_DELTA   2
+#define WS_BIN_MAX_FRAME    (8 + 4 + 8 + 2 + 64 + 12)
+
+// 按字段掩码编码一帧，返回帧长度，空间不足返回 -1
+int ws_bin_encode(uint8_t *buf, size_t size, uint8_t type, uint32_t seq, uint32_t fields);
+
+#endif // WS_BIN_H
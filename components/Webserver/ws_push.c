@@ -0,0 +1,740 @@
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "data_process.h"
+#include "settings.h"
+#include "data_json.h"
+#include "ws_bin.h"
+#include "ws_push.h"
+#include "sse.h"
+#include "metrics.h"
+#include "trace.h"
+#include "web_session.h"
+#include "web_sendq.h"
+
+static const char *TAG = "WS_PUSH";
+
+// 主题下标，与 WS_TOPIC_* 的位序一致
+enum { TOPIC_LIVE, TOPIC_STATS, TOPIC_HISTORY, TOPIC_ALARM, TOPIC_DIAG };
+
+static const char *const s_topic_names[WS_TOPIC_COUNT] = { "live", "stats", "history", "alarm", "diag" };
+
+// 各主题在增量消息中对应的字段组，alarm / diag 是独立消息
+static const uint32_t s_topic_fields[WS_TOPIC_COUNT] = {
+    DATA_JSON_LIVE, DATA_JSON_TODAY | DATA_JSON_ALARM, DATA_JSON_HISTORY, 0, 0,
+};
+
+// 单个推送客户端的状态
+typedef struct {
+    int fd;                 // -1 表示空位
+    uint8_t proto;          // WS_PROTO_V1 / WS_PROTO_V2 / WS_PROTO_BIN
+    uint8_t topics;         // 订阅的主题（WS_TOPIC_*，仅 v2 与 bin）
+    uint8_t force_fields;   // 新订阅的字段组，下一条消息中无论是否变化都要发送
+    uint32_t seq;           // 已发给该客户端的最后一条消息序号（v2 与 bin）
+    uint32_t sample_seq;    // 该客户端已知的采样序号
+    uint32_t today_gen;     // 该客户端已知的今日极值版本
+    uint32_t history_gen;   // 该客户端已知的历史版本
+    int alarm_x10;          // 该客户端已知的报警阈值（放大 10 倍）
+    bool synced;            // 是否已收到过完整快照
+    bool alarm_known;       // alarm 主题：是否已发过当前状态
+    bool alarm_active;      // alarm 主题：该客户端已知的超温状态
+    int alarm_topic_x10;    // alarm 主题：该客户端已知的报警阈值
+    uint16_t interval_s[WS_TOPIC_COUNT];    // 各主题的最小推送间隔（秒），0 为每个采样周期
+    int64_t last_us[WS_TOPIC_COUNT];        // 各主题上次推送的时间
+    int64_t last_send_us;   // 上一条 v2 消息（含心跳）的发送时间
+    web_sendq_t q;          // 等待发送的帧（socket 发送缓冲满时积压在这里）
+    uint32_t pending_fields;    // 队列中那条 DATA 帧（v2 / bin）包含的字段组
+    bool pending_snap;          // 队列中那条 DATA 帧是否为快照
+    uint16_t backfill_n;        // 待补发的样本数
+    bool resume_pending;        // 是否有待处理的断线续传请求
+    char resume_token[DATA_JSON_TOKEN_LEN]; // 续传起点：客户端收到的最后一个样本的令牌
+} ws_client_t;
+
+static httpd_handle_t s_server = NULL;
+
+// 增删和广播都在 httpd 任务里执行，因此不需要加锁
+static ws_client_t s_clients[WS_PUSH_MAX_CLIENTS] = { [0 ... WS_PUSH_MAX_CLIENTS - 1] = { .fd = -1 } };
+
+// 帧缓冲区同样只在 httpd 任务中使用，避免每次推送都 malloc
+static char s_full_buf[DATA_JSON_BUF_SIZE];
+static char s_frame_buf[DATA_JSON_BUF_SIZE + 64];
+static uint8_t s_bin_buf[WS_BIN_MAX_FRAME];
+
+// 各客户端的发送队列缓冲，启动时一次性分配（优先 PSRAM）
+static uint8_t *s_queue_pool = NULL;
+// 队列非空时定期重试发送
+static esp_timer_handle_t s_drain_timer = NULL;
+// 补发帧缓冲（放得下 WS_PUSH_BACKFILL_MAX 个样本），与队列一起分配
+static char *s_backfill_buf = NULL;
+
+// 断开客户端：清空队列并让 httpd 关闭会话
+static void ws_push_drop_client(ws_client_t *c)
+{
+    int fd = c->fd;
+    c->fd = -1;
+    web_sendq_reset(&c->q, c->q.buf);
+    httpd_sess_trigger_close(s_server, fd);
+}
+
+// 丢弃队列中尚未发出的某类帧（被更新的同类帧取代），返回是否丢弃了
+static bool ws_queue_drop(ws_client_t *c, uint8_t kind)
+{
+    if (!web_sendq_drop(&c->q, kind)) {
+        return false;
+    }
+    METRICS_INC(METRIC_WS_FRAMES_REPLACED);
+    return true;
+}
+
+// 写出队列中的帧，直到清空或 socket 发送缓冲再次写满（写不下的部分下次续写）；
+// 出错或积压超过 WEB_SENDQ_STALL_MS 没有任何进展的客户端直接断开
+static void ws_push_drain(ws_client_t *c, int64_t now)
+{
+    uint32_t frames = 0;
+    uint32_t bytes = 0;
+    esp_err_t err = web_sendq_drain(&c->q, s_server, c->fd, now, &frames, &bytes);
+    METRICS_ADD(METRIC_WS_FRAMES_SENT, frames);
+    METRICS_ADD(METRIC_WS_BYTES_SENT, bytes);
+    if (err == ESP_FAIL) {
+        METRICS_INC(METRIC_WS_SEND_ERRORS);
+        ESP_LOGW(TAG, "推送到 fd=%d 失败，关闭该会话", c->fd);
+        ws_push_drop_client(c);
+    } else if (err == ESP_ERR_TIMEOUT) {
+        METRICS_INC(METRIC_WS_SLOW_CLOSED);
+        ESP_LOGW(TAG, "fd=%d 发送积压 %d 帧超过 %d ms，断开", c->fd, c->q.count, WEB_SENDQ_STALL_MS);
+        ws_push_drop_client(c);
+    }
+}
+
+void ws_push_schedule_drain(void)
+{
+    if (s_drain_timer != NULL && !esp_timer_is_active(s_drain_timer)) {
+        esp_timer_start_once(s_drain_timer, (uint64_t)WS_PUSH_DRAIN_MS * 1000);
+    }
+}
+
+// 发送一帧：连同帧头复制进该客户端的队列，再尽量写出；socket 发送缓冲写满时剩下的留在队列里，
+// 等定时重试续写，httpd 任务不会阻塞在慢客户端上。队列放不下说明客户端落后太多，断开它
+static esp_err_t ws_push_send(ws_client_t *c, httpd_ws_type_t type, const void *payload, size_t len, uint8_t kind)
+{
+    uint8_t hdr[4];
+    size_t hdr_len = web_sendq_ws_header(hdr, type, len);
+    if (web_sendq_push(&c->q, hdr, hdr_len, payload, len, NULL, 0, kind) != ESP_OK) {
+        METRICS_INC(METRIC_WS_SLOW_CLOSED);
+        ESP_LOGW(TAG, "fd=%d 发送队列已满，断开", c->fd);
+        ws_push_drop_client(c);
+        return ESP_FAIL;
+    }
+    ws_push_drain(c, esp_timer_get_time());
+    if (c->fd >= 0 && c->q.count > 0) {
+        ws_push_schedule_drain();
+    }
+    return c->fd >= 0 ? ESP_OK : ESP_FAIL;
+}
+
+// 主题在本周期是否需要推送：已订阅，且距上次推送已超过它的最小间隔
+static bool ws_topic_due(const ws_client_t *c, int topic, int64_t now)
+{
+    if (!(c->topics & (1u << topic))) {
+        return false;
+    }
+    return c->interval_s[topic] == 0 || c->last_us[topic] == 0 ||
+           now - c->last_us[topic] >= (int64_t)c->interval_s[topic] * 1000000;
+}
+
+// 解析主题列表 "live:10,alarm diag"，返回识别出的主题位图，间隔写入 intervals
+static uint8_t ws_topics_parse(const char *spec, uint16_t *intervals)
+{
+    uint8_t mask = 0;
+    const char *p = spec;
+    while (*p) {
+        while (*p == ',' || *p == ' ') {
+            p++;
+        }
+        if (*p == '\0') {
+            break;
+        }
+        const char *name = p;
+        while (*p && *p != ',' && *p != ' ' && *p != ':') {
+            p++;
+        }
+        size_t len = p - name;
+        unsigned long interval = 0;
+        if (*p == ':') {
+            char *end;
+            interval = strtoul(p + 1, &end, 10);
+            p = end;
+        }
+        while (*p && *p != ',' && *p != ' ') {
+            p++;
+        }
+
+        int topic = -1;
+        for (int i = 0; i < WS_TOPIC_COUNT; i++) {
+            if (strlen(s_topic_names[i]) == len && strncmp(s_topic_names[i], name, len) == 0) {
+                topic = i;
+                break;
+            }
+        }
+        if (topic < 0) {
+            ESP_LOGW(TAG, "未知主题: %.*s", (int)len, name);
+            continue;
+        }
+        mask |= 1u << topic;
+        intervals[topic] = interval > UINT16_MAX ? UINT16_MAX : (uint16_t)interval;
+    }
+    return mask;
+}
+
+// 生成完整 JSON（v1 帧），返回长度，失败返回 -1
+static int ws_push_build_full(void)
+{
+    return data_json_write_full(s_full_buf, sizeof(s_full_buf));
+}
+
+// 给 v2 / bin 客户端推送一条快照或增量消息，只包含已订阅且到了推送时间的字段组，
+// 发送成功后只更新实际发出的字段组的已知状态，被限速压下的变化留到下次再发
+static void ws_push_send_v2(ws_client_t *c, bool snapshot, int64_t now)
+{
+    uint32_t sample = get_sample_seq();
+    uint32_t today = get_today_gen();
+    uint32_t history = get_history_gen();
+    int alarm = (int)settings_get_alarm_x10();
+
+    // 上一条数据帧还积压在队列里：丢掉它，把它的字段并进这一条（取当前值）并沿用它的序号，
+    // 客户端看到的序号依旧连续
+    bool replaced = ws_queue_drop(c, WEB_SENDQ_DATA);
+    if (replaced) {
+        snapshot = snapshot || c->pending_snap;
+    }
+
+    uint32_t fields = 0;
+    for (int i = TOPIC_LIVE; i <= TOPIC_HISTORY; i++) {
+        if (snapshot ? (c->topics & (1u << i)) != 0 : ws_topic_due(c, i, now)) {
+            fields |= s_topic_fields[i];
+        }
+    }
+    if (!snapshot) {
+        uint32_t changed = c->force_fields;
+        if (c->sample_seq != sample) changed |= DATA_JSON_LIVE;
+        if (c->today_gen != today) changed |= DATA_JSON_TODAY;
+        if (c->alarm_x10 != alarm) changed |= DATA_JSON_ALARM;
+        if (c->history_gen != history) changed |= DATA_JSON_HISTORY;
+        fields &= changed;
+        // 没有新字段时隔一段时间发一条只带序号的消息，充当前端看门狗的心跳
+        if (fields == 0 && !replaced && now - c->last_send_us < (int64_t)WS_PUSH_HEARTBEAT_MS * 1000) {
+            return;
+        }
+    }
+    if (replaced) {
+        fields |= c->pending_fields;
+    }
+    // 实时值带上样本序号与设备时间，客户端断线重连后凭序号续传
+    if (fields & DATA_JSON_LIVE) {
+        fields |= DATA_JSON_SAMPLE;
+    }
+
+    uint32_t seq = replaced ? c->seq : c->seq + 1;
+    esp_err_t ret;
+    if (c->proto == WS_PROTO_BIN) {
+        int len = ws_bin_encode(s_bin_buf, sizeof(s_bin_buf),
+                                snapshot ? WS_BIN_TYPE_SNAP : WS_BIN_TYPE_DELTA, seq, fields);
+        if (len < 0) {
+            return;
+        }
+        ret = ws_push_send(c, HTTPD_WS_TYPE_BINARY, s_bin_buf, len, WEB_SENDQ_DATA);
+    } else {
+        int len = data_json_write_frame(s_frame_buf, sizeof(s_frame_buf), snapshot, seq, fields);
+        if (len < 0) {
+            ESP_LOGE(TAG, "v2 帧超出缓冲区");
+            return;
+        }
+        ret = ws_push_send(c, HTTPD_WS_TYPE_TEXT, s_frame_buf, len, WEB_SENDQ_DATA);
+    }
+
+    // 已发出或已进入队列：之后的增量都以此为基准
+    if (ret == ESP_OK) {
+        c->seq = seq;
+        c->pending_fields = fields;
+        c->pending_snap = snapshot;
+        if (fields & DATA_JSON_LIVE) c->sample_seq = sample;
+        if (fields & DATA_JSON_TODAY) c->today_gen = today;
+        if (fields & DATA_JSON_HISTORY) c->history_gen = history;
+        if (fields & DATA_JSON_ALARM) c->alarm_x10 = alarm;
+        c->force_fields &= ~fields;
+        for (int i = TOPIC_LIVE; i <= TOPIC_HISTORY; i++) {
+            if (fields & s_topic_fields[i]) {
+                c->last_us[i] = now;
+            }
+        }
+        c->last_send_us = now;
+        c->synced = true;
+    }
+}
+
+// alarm 主题：超温状态或阈值与该客户端已知的不同时发送一条 alarm 消息
+static void ws_push_send_alarm(ws_client_t *c, int64_t now)
+{
+    if (!ws_topic_due(c, TOPIC_ALARM, now)) {
+        return;
+    }
+    int alarm = (int)settings_get_alarm_x10();
+    int temp = get_temperature_int() * 10 + get_temperature_dec();
+    bool active = temp > alarm;
+    if (c->alarm_known && active == c->alarm_active && alarm == c->alarm_topic_x10) {
+        return;
+    }
+
+    json_writer_t w;
+    json_writer_init_buf(&w, s_frame_buf, sizeof(s_frame_buf));
+    json_obj_begin(&w);
+    json_kv_int(&w, "v", 2);
+    json_kv_str(&w, "type", "alarm");
+    json_kv_bool(&w, "active", active);
+    json_kv_fixed_str(&w, "temperature", temp, 1);
+    json_kv_fixed_str(&w, "alarmThreshold", alarm, 1);
+    json_obj_end(&w);
+    int len = json_writer_finish(&w);
+    if (len > 0 && ws_push_send(c, HTTPD_WS_TYPE_TEXT, s_frame_buf, len, WEB_SENDQ_EVENT) == ESP_OK) {
+        c->alarm_known = true;
+        c->alarm_active = active;
+        c->alarm_topic_x10 = alarm;
+        c->last_us[TOPIC_ALARM] = now;
+    }
+}
+
+static int ws_push_client_count(void)
+{
+    int n = 0;
+    for (int i = 0; i < WS_PUSH_MAX_CLIENTS; i++) {
+        if (s_clients[i].fd >= 0) {
+            n++;
+        }
+    }
+    return n;
+}
+
+// diag 主题：按订阅的间隔发送设备运行状态
+static void ws_push_send_diag(ws_client_t *c, int64_t now)
+{
+    if (!ws_topic_due(c, TOPIC_DIAG, now)) {
+        return;
+    }
+    json_writer_t w;
+    json_writer_init_buf(&w, s_frame_buf, sizeof(s_frame_buf));
+    json_obj_begin(&w);
+    json_kv_int(&w, "v", 2);
+    json_kv_str(&w, "type", "diag");
+    json_kv_uint(&w, "uptime_s", (uint64_t)(now / 1000000));
+    json_kv_uint(&w, "sample_seq", get_sample_seq());
+    json_kv_uint(&w, "heap_internal", heap_caps_get_free_size(MALLOC_CAP_INTERNAL));
+    json_kv_uint(&w, "heap_psram", heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
+    json_kv_int(&w, "ws_clients", ws_push_client_count());
+    json_obj_end(&w);
+    int len = json_writer_finish(&w);
+    if (len > 0 && ws_push_send(c, HTTPD_WS_TYPE_TEXT, s_frame_buf, len, WEB_SENDQ_DIAG) == ESP_OK) {
+        c->last_us[TOPIC_DIAG] = now;
+    }
+}
+
+// 给 v2 / bin 客户端推送本周期到期的全部内容
+static void ws_push_send_topics(ws_client_t *c, bool snapshot, int64_t now)
+{
+    ws_push_send_v2(c, snapshot, now);
+    if (c->fd >= 0) {
+        ws_push_send_alarm(c, now);
+    }
+    if (c->fd >= 0) {
+        ws_push_send_diag(c, now);
+    }
+}
+
+// 广播任务：在 httpd 任务中执行，v1 完整 JSON 只生成一次，v2 按客户端生成增量，最后推送 SSE
+// arg 不为 NULL 表示由设置变化触发：报警阈值不受 stats 主题推送间隔的限制，立即发出
+static void ws_push_broadcast_work(void *arg)
+{
+    bool settings = arg != NULL;
+    TRACE_BEGIN(TRACE_WS_BROADCAST);
+    uint32_t alloc_mark = web_alloc_count();
+    int64_t now = esp_timer_get_time();
+    int full_len = 0; // 0 表示尚未生成
+
+    for (int i = 0; i < WS_PUSH_MAX_CLIENTS; i++) {
+        ws_client_t *c = &s_clients[i];
+        if (c->fd < 0) {
+            continue;
+        }
+        // 会话可能已被 LRU 回收，先确认它仍是 WebSocket 连接
+        if (httpd_ws_get_fd_info(s_server, c->fd) != HTTPD_WS_CLIENT_WEBSOCKET) {
+            c->fd = -1;
+            web_sendq_reset(&c->q, c->q.buf);
+            continue;
+        }
+        // 先把积压的帧尽量发出去（同时检查是否卡住太久）
+        ws_push_drain(c, now);
+        if (c->fd < 0) {
+            continue;
+        }
+
+        if (c->proto == WS_PROTO_V1) {
+            if (full_len == 0) {
+                full_len = ws_push_build_full();
+            }
+            // 整帧自带全部数据，积压中的旧整帧直接由新的取代
+            ws_queue_drop(c, WEB_SENDQ_DATA);
+            if (full_len > 0) {
+                ws_push_send(c, HTTPD_WS_TYPE_TEXT, s_full_buf, full_len, WEB_SENDQ_DATA);
+            }
+        } else {
+            if (settings && (c->topics & WS_TOPIC_STATS)) {
+                c->force_fields |= DATA_JSON_ALARM;
+                c->last_us[TOPIC_STATS] = 0;
+            }
+            ws_push_send_topics(c, !c->synced, now);
+        }
+    }
+
+    // SSE 连接与 WebSocket 共用同一个广播节拍
+    sse_broadcast();
+    // 稳态推送应完全不分配堆内存
+    METRICS_ADD(METRIC_WS_PUSH_ALLOCS, web_alloc_count() - alloc_mark);
+    TRACE_END(TRACE_WS_BROADCAST);
+}
+
+static ws_client_t *ws_push_find(int fd)
+{
+    for (int i = 0; i < WS_PUSH_MAX_CLIENTS; i++) {
+        if (s_clients[i].fd == fd) {
+            return &s_clients[i];
+        }
+    }
+    return NULL;
+}
+
+void ws_push_settings_changed(void)
+{
+    if (s_server) {
+        httpd_queue_work(s_server, ws_push_broadcast_work, (void *)1);
+    }
+}
+
+esp_err_t ws_push_send_event(int fd, const char *text, size_t len)
+{
+    ws_client_t *c = ws_push_find(fd);
+    if (c == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    return ws_push_send(c, HTTPD_WS_TYPE_TEXT, text, len, WEB_SENDQ_EVENT);
+}
+
+esp_err_t ws_push_reply(httpd_req_t *req, const char *text, size_t len)
+{
+    ws_client_t *c = ws_push_find(httpd_req_to_sockfd(req));
+    if (c != NULL) {
+        return ws_push_send(c, HTTPD_WS_TYPE_TEXT, text, len, WEB_SENDQ_EVENT);
+    }
+    httpd_ws_frame_t frame = {
+        .type = HTTPD_WS_TYPE_TEXT,
+        .payload = (uint8_t *)text,
+        .len = len,
+    };
+    esp_err_t err = httpd_ws_send_frame(req, &frame);
+    if (err == ESP_OK) {
+        METRICS_INC(METRIC_WS_FRAMES_SENT);
+        METRICS_ADD(METRIC_WS_BYTES_SENT, len);
+    }
+    return err;
+}
+
+esp_err_t ws_push_send_pong(httpd_req_t *req, const uint8_t *payload, size_t len)
+{
+    ws_client_t *c = ws_push_find(httpd_req_to_sockfd(req));
+    if (c == NULL) {
+        // 未订阅推送的连接没有队列，socket 上也不会有写了一半的帧，直接回复
+        httpd_ws_frame_t frame = {
+            .type = HTTPD_WS_TYPE_PONG,
+            .payload = (uint8_t *)payload,
+            .len = len,
+        };
+        return httpd_ws_send_frame(req, &frame);
+    }
+    return ws_push_send(c, HTTPD_WS_TYPE_PONG, payload, len, WEB_SENDQ_EVENT);
+}
+
+// 补发 / 续传帧，不占消息序号，作为必须送达的事件入队。
+// 续传的缺口无法补齐时返回 true，调用者应推送新快照
+static bool ws_push_send_samples(ws_client_t *c)
+{
+    bool gap = false;
+    while (s_backfill_buf != NULL && c->fd >= 0 && (c->backfill_n > 0 || c->resume_pending)) {
+        json_writer_t w;
+        json_writer_init_buf(&w, s_backfill_buf, WS_PUSH_BACKFILL_BUF);
+        json_obj_begin(&w);
+        json_kv_int(&w, "v", 2);
+        if (c->resume_pending) {
+            // 缺的样本都还在缓冲里就原样补齐，否则通知客户端缺口太大、以新快照为准
+            json_kv_str(&w, "type", "resume");
+            gap = data_json_since(&w, c->resume_token, WS_PUSH_BACKFILL_MAX) < 0;
+            json_kv_str(&w, "status", gap ? "gap" : "ok");
+            if (gap) {
+                data_json_cursor(&w);
+            }
+            c->resume_pending = false;
+        } else {
+            json_kv_str(&w, "type", "backfill");
+            data_json_recent(&w, c->backfill_n);
+            c->backfill_n = 0;
+        }
+        json_obj_end(&w);
+        int len = json_writer_finish(&w);
+        if (len < 0) {
+            ESP_LOGE(TAG, "补发帧超出缓冲区");
+            continue;
+        }
+        ws_push_send(c, HTTPD_WS_TYPE_TEXT, s_backfill_buf, len, WEB_SENDQ_EVENT);
+    }
+    return gap;
+}
+
+// 单播任务：新连接握手后或客户端请求重新同步时，立即推送一帧完整数据
+// 握手时请求的补发 / 续传样本先于快照发出，客户端先补齐断线期间的曲线，再接上快照中的实时值
+static void ws_push_snapshot_work(void *arg)
+{
+    int fd = (int)(intptr_t)arg;
+    ws_client_t *c = ws_push_find(fd);
+    if (c == NULL || httpd_ws_get_fd_info(s_server, fd) != HTTPD_WS_CLIENT_WEBSOCKET) {
+        return;
+    }
+
+    if (c->proto == WS_PROTO_V1) {
+        int len = ws_push_build_full();
+        ws_queue_drop(c, WEB_SENDQ_DATA);
+        if (len > 0) {
+            ws_push_send(c, HTTPD_WS_TYPE_TEXT, s_full_buf, len, WEB_SENDQ_DATA);
+        }
+    } else {
+        ws_push_send_samples(c);
+        if (c->fd >= 0) {
+            ws_push_send_topics(c, true, esp_timer_get_time());
+        }
+    }
+}
+
+// 补发 / 续传任务：连接建立之后收到的 "backfill N" / "resume N" 命令
+// 握手时带的请求已在快照任务中处理，这里什么也不发
+static void ws_push_samples_work(void *arg)
+{
+    int fd = (int)(intptr_t)arg;
+    ws_client_t *c = ws_push_find(fd);
+    if (c == NULL || httpd_ws_get_fd_info(s_server, fd) != HTTPD_WS_CLIENT_WEBSOCKET) {
+        return;
+    }
+    if (ws_push_send_samples(c) && c->fd >= 0) {
+        ws_push_send_topics(c, true, esp_timer_get_time());
+    }
+}
+
+esp_err_t ws_push_backfill(int fd, int minutes)
+{
+    ws_client_t *c = ws_push_find(fd);
+    if (c == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (c->proto == WS_PROTO_V1 || minutes <= 0) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    // 采样周期 2 秒，每分钟 30 个样本
+    int n = minutes * 30;
+    c->backfill_n = n < WS_PUSH_BACKFILL_MAX ? n : WS_PUSH_BACKFILL_MAX;
+    return httpd_queue_work(s_server, ws_push_samples_work, (void *)(intptr_t)fd);
+}
+
+esp_err_t ws_push_resume(int fd, const char *token)
+{
+    ws_client_t *c = ws_push_find(fd);
+    if (c == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (c->proto == WS_PROTO_V1) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    ESP_LOGI(TAG, "客户端 fd=%d 从样本 %s 之后续传", fd, token);
+    c->resume_pending = true;
+    snprintf(c->resume_token, sizeof(c->resume_token), "%s", token);
+    return httpd_queue_work(s_server, ws_push_samples_work, (void *)(intptr_t)fd);
+}
+
+// 配网状态推送：只发给 v2 / bin 客户端，旧版页面只认完整数据帧
+static void ws_push_prov_work(void *arg)
+{
+    int len = data_json_write_prov(s_frame_buf, sizeof(s_frame_buf), true);
+    if (len < 0) {
+        return;
+    }
+    for (int i = 0; i < WS_PUSH_MAX_CLIENTS; i++) {
+        ws_client_t *c = &s_clients[i];
+        if (c->fd >= 0 && c->proto != WS_PROTO_V1 &&
+            httpd_ws_get_fd_info(s_server, c->fd) == HTTPD_WS_CLIENT_WEBSOCKET) {
+            ws_push_send(c, HTTPD_WS_TYPE_TEXT, s_frame_buf, len, WEB_SENDQ_EVENT);
+        }
+    }
+}
+
+void ws_push_prov_changed(void)
+{
+    if (s_server) {
+        httpd_queue_work(s_server, ws_push_prov_work, NULL);
+    }
+}
+
+// 定时重试：续写积压的帧（含 SSE 连接），仍有积压则继续定时
+static void ws_push_drain_work(void *arg)
+{
+    int64_t now = esp_timer_get_time();
+    bool pending = false;
+    for (int i = 0; i < WS_PUSH_MAX_CLIENTS; i++) {
+        ws_client_t *c = &s_clients[i];
+        if (c->fd >= 0 && c->q.count > 0) {
+            ws_push_drain(c, now);
+            pending |= c->fd >= 0 && c->q.count > 0;
+        }
+    }
+    pending |= sse_drain(now);
+    if (pending) {
+        ws_push_schedule_drain();
+    }
+}
+
+// 定时器回调运行在 esp_timer 任务中，只负责把重试排进 httpd 的工作队列
+static void ws_push_drain_timer_cb(void *arg)
+{
+    if (s_server) {
+        httpd_queue_work(s_server, ws_push_drain_work, NULL);
+    }
+}
+
+// 采样通知回调：运行在采集任务中，只负责把广播排进 httpd 的工作队列
+static void ws_push_on_sample(void *arg)
+{
+    if (s_server) {
+        httpd_queue_work(s_server, ws_push_broadcast_work, NULL);
+    }
+}
+
+void ws_push_start(httpd_handle_t server)
+{
+    s_server = server;
+
+    // 发送队列共 WS_PUSH_MAX_CLIENTS × WEB_SENDQ_BYTES 字节，之后不再分配
+    if (s_queue_pool == NULL) {
+        s_queue_pool = web_sendq_alloc_pool(WS_PUSH_MAX_CLIENTS);
+        if (s_queue_pool == NULL) {
+            ESP_LOGE(TAG, "发送队列分配失败，无法推送");
+        }
+    }
+    if (s_backfill_buf == NULL) {
+        s_backfill_buf = heap_caps_malloc(WS_PUSH_BACKFILL_BUF, MALLOC_CAP_SPIRAM);
+        if (s_backfill_buf == NULL) {
+            s_backfill_buf = heap_caps_malloc(WS_PUSH_BACKFILL_BUF, MALLOC_CAP_DEFAULT);
+        }
+    }
+    if (s_drain_timer == NULL) {
+        const esp_timer_create_args_t args = {
+            .callback = ws_push_drain_timer_cb,
+            .name = "ws_drain",
+        };
+        esp_timer_create(&args, &s_drain_timer);
+    }
+
+    data_process_register_notify(ws_push_on_sample, NULL);
+}
+
+esp_err_t ws_push_add_client(int fd, int proto, const char *topics)
+{
+    ws_client_t *slot = ws_push_find(fd); // 同一个 fd 重复握手，复用原位置
+    if (slot == NULL) {
+        slot = ws_push_find(-1);
+    }
+    if (slot == NULL) {
+        ESP_LOGW(TAG, "推送客户端已满，fd=%d 无法订阅", fd);
+        return ESP_ERR_NO_MEM;
+    }
+    memset(slot, 0, sizeof(ws_client_t));
+    slot->fd = fd;
+    web_sendq_reset(&slot->q, s_queue_pool ? s_queue_pool + (slot - s_clients) * WEB_SENDQ_BYTES : NULL);
+    slot->proto = (proto == WS_PROTO_V2 || proto == WS_PROTO_BIN) ? proto : WS_PROTO_V1;
+    slot->topics = topics != NULL ? ws_topics_parse(topics, slot->interval_s) : WS_TOPIC_DEFAULT;
+    ESP_LOGI(TAG, "客户端 fd=%d 已订阅实时推送 (协议 %d, 主题 0x%02x)", fd, slot->proto, slot->topics);
+
+    return httpd_queue_work(s_server, ws_push_snapshot_work, (void *)(intptr_t)fd);
+}
+
+esp_err_t ws_push_subscribe(int fd, const char *spec, bool subscribe)
+{
+    ws_client_t *c = ws_push_find(fd);
+    if (c == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (c->proto == WS_PROTO_V1) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    uint16_t intervals[WS_TOPIC_COUNT] = { 0 };
+    uint8_t mask = ws_topics_parse(spec, intervals);
+    if (subscribe) {
+        uint8_t added = mask & ~c->topics;
+        for (int i = 0; i < WS_TOPIC_COUNT; i++) {
+            if (mask & (1u << i)) {
+                c->interval_s[i] = intervals[i];
+            }
+            if (added & (1u << i)) {
+                // 新订阅：字段组在下一条消息里补发完整值，alarm 补发当前状态
+                c->force_fields |= s_topic_fields[i];
+                c->last_us[i] = 0;
+                if (i == TOPIC_ALARM) {
+                    c->alarm_known = false;
+                }
+            }
+        }
+        c->topics |= mask;
+    } else {
+        c->topics &= ~mask;
+    }
+    ESP_LOGI(TAG, "客户端 fd=%d 主题更新为 0x%02x", fd, c->topics);
+    return ESP_OK;
+}
+
+esp_err_t ws_push_resync(int fd)
+{
+    ws_client_t *c = ws_push_find(fd);
+    if (c == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    ESP_LOGI(TAG, "客户端 fd=%d 请求重新同步", fd);
+    c->synced = false;
+    return httpd_queue_work(s_server, ws_push_snapshot_work, (void *)(intptr_t)fd);
+}
+
+void ws_push_remove_client(int fd)
+{
+    ws_client_t *c = ws_push_find(fd);
+    if (c != NULL) {
+        c->fd = -1;
+        web_sendq_reset(&c->q, c->q.buf);
+        ESP_LOGI(TAG, "客户端 fd=%d 已取消订阅", fd);
+    }
+}
+
+bool ws_push_queue_info(int index, ws_push_queue_info_t *out)
+{
+    if (index < 0 || index >= WS_PUSH_MAX_CLIENTS || s_clients[index].fd < 0) {
+        return false;
+    }
+    out->fd = s_clients[index].fd;
+    out->frames = s_clients[index].q.count;
+    out->bytes = s_clients[index].q.bytes;
+    return true;
+}
@@ -0,0 +1,103 @@
+#ifndef WS_PUSH_H
+#define WS_PUSH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_http_server.h"
+#include "web_session.h"
+
+// 同时跟踪的 WebSocket 客户端上限：每个 socket 最多一个客户端，取 httpd 的 max_open_sockets
+#define WS_PUSH_MAX_CLIENTS WEB_SESSION_MAX
+
+// 推送协议版本
+// v1：每个采样周期推送与 /data 相同的完整 JSON
+// v2：订阅时推送一次完整快照，之后只推送变化的字段，并带逐客户端消息序号
+// bin：v2 语义的二进制编码（见 ws_bin.h），通过 Sec-WebSocket-Protocol 协商
+#define WS_PROTO_V1  1
+#define WS_PROTO_V2  2
+#define WS_PROTO_BIN 3
+
+// v2 / bin 客户端可订阅的主题，每个主题可设最小推送间隔（秒）
+// live / stats / history 对应增量消息中的字段组，alarm / diag 是独立的文本消息（不占消息序号）
+#define WS_TOPIC_LIVE     (1u << 0) // 实时温湿度
+#define WS_TOPIC_STATS    (1u << 1) // 今日极值与报警阈值
+#define WS_TOPIC_HISTORY  (1u << 2) // 七天历史
+#define WS_TOPIC_ALARM    (1u << 3) // 超温状态或阈值变化：{"v":2,"type":"alarm",...}
+#define WS_TOPIC_DIAG     (1u << 4) // 设备运行状态：{"v":2,"type":"diag",...}
+#define WS_TOPIC_COUNT    5
+// 握手时未指定主题的 v2 客户端默认订阅的内容，与原先推送的字段一致
+#define WS_TOPIC_DEFAULT  (WS_TOPIC_LIVE | WS_TOPIC_STATS | WS_TOPIC_HISTORY)
+
+// 没有任何字段需要推送时，至少隔这么久发一条只带序号的心跳（前端看门狗为 8 秒）
+#define WS_PUSH_HEARTBEAT_MS 5000
+
+// 每个客户端有一个发送队列（web_sendq.h）：所有帧都先进队列，再以非阻塞方式写给 socket，
+// 发送缓冲满（弱信号手机等）时写不下的部分积压在队列里，不阻塞 httpd 任务。
+// 积压期间新的数据帧取代队列中的旧数据帧（最新值覆盖旧值，v2 沿用旧帧序号并合并字段）；
+// 队列超出上限或持续 WEB_SENDQ_STALL_MS 写不出去的客户端直接断开
+// 有积压时重试发送的间隔（WebSocket 与 SSE 共用同一个定时器）
+#define WS_PUSH_DRAIN_MS      200
+
+// 订阅时补发的最近样本上限（约 5 分钟）与帧缓冲大小，整帧须能放进发送队列
+#define WS_PUSH_BACKFILL_MAX  150
+#define WS_PUSH_BACKFILL_BUF  3072
+
+// 单个客户端的队列状态，供 /metrics 导出
+typedef struct {
+    int fd;
+    uint8_t frames;
+    uint16_t bytes;
+} ws_push_queue_info_t;
+
+// 绑定服务器句柄，并向数据采集模块注册采样通知
+void ws_push_start(httpd_handle_t server);
+
+// WebSocket 握手完成后登记客户端，并立即给它补推一帧完整数据
+// topics 为握手地址中的主题列表（格式同 ws_push_subscribe），NULL 表示默认主题
+esp_err_t ws_push_add_client(int fd, int proto, const char *topics);
+
+// 订阅 / 退订主题，spec 形如 "live:10,alarm"（逗号或空格分隔，冒号后为最小间隔秒数，省略为每个采样周期）
+// 新订阅的字段组在下一条消息中完整补发；只对 v2 / bin 客户端生效
+esp_err_t ws_push_subscribe(int fd, const char *spec, bool subscribe);
+
+// 补发最近 minutes 分钟的样本：{"v":2,"type":"backfill",...}（格式见 data_json_recent，不占消息序号）
+// 握手时由 /ws?v=2&backfill=5 触发（在订阅快照之前发出），之后也可发送文本 "backfill 5"；只对 v2 / bin 客户端生效
+esp_err_t ws_push_backfill(int fd, int minutes);
+
+// 断线续传：token 为客户端收到的最后一个样本的续传令牌（消息中的 boot 与 sample_seq，见 data_json.h），
+// 补发其后的全部样本 {"v":2,"type":"resume","status":"ok",...}（格式见 data_json_since，不占消息序号）；
+// 缺口开头已被覆盖、超过 WS_PUSH_BACKFILL_MAX 个样本或令牌来自设备重启之前时
+// 回 {"status":"gap","boot":"...","sample_seq":最新序号}，并重新推送快照。
+// 握手时由 /ws?v=2&resume=<令牌> 触发（在订阅快照之前发出），之后也可发送文本 "resume <令牌>"
+esp_err_t ws_push_resume(int fd, const char *token);
+
+// 客户端发现序号缺口时请求重新同步，服务端重新推送完整快照
+esp_err_t ws_push_resync(int fd);
+
+// 配网状态变化时推送给 v2 / bin 客户端（可在任意任务中调用）
+void ws_push_prov_changed(void);
+
+// 设置（报警阈值）变化后立即推送给所有客户端（含 SSE），不必等下一个采样周期；可在任意任务中调用
+// v2 / bin 客户端只要订阅了 stats 就立即收到新阈值，不受该主题的推送间隔限制
+void ws_push_settings_changed(void);
+
+// 单播一条事件消息（控制命令的回复等），经该客户端的发送队列送出且不会被新帧取代；在 httpd 任务中调用
+esp_err_t ws_push_send_event(int fd, const char *text, size_t len);
+
+// 回复 WebSocket 请求（get、控制命令）：已订阅推送的连接经发送队列送出，
+// 未订阅（客户端已满）的连接没有队列，直接写帧；在 WebSocket 处理函数中调用
+esp_err_t ws_push_reply(httpd_req_t *req, const char *text, size_t len);
+
+// 回复客户端的 PING，经该连接的发送队列送出；在 WebSocket 处理函数中调用
+esp_err_t ws_push_send_pong(httpd_req_t *req, const uint8_t *payload, size_t len);
+
+// 有连接积压了待发送的帧时调用，WS_PUSH_DRAIN_MS 后在 httpd 任务中重试发送（SSE 的队列也在其中续写）
+void ws_push_schedule_drain(void);
+
+// 会话关闭时移除客户端（在 httpd 的 close_fn 中调用）
+void ws_push_remove_client(int fd);
+
+// 遍历客户端的发送队列（在 httpd 任务中调用），该位置没有客户端时返回 false
+bool ws_push_queue_info(int index, ws_push_queue_info_t *out);
+
+#endif // WS_PUSH_H
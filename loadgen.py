@@ -0,0 +1,586 @@
+#!/usr/bin/env python3
+"""
+温湿度监测服务的负载生成与基准测试 / Load generator and benchmark
+
+按阶段逐级增加并发：每个阶段同时运行 N 个 HTTP 轮询客户端和 N 个 WebSocket 订阅者，
+记录延迟分位数（p50/p95/p99）、实际达到的每秒请求数、首页 "/" 的首字节时间（TTFB），
+并在每个阶段前后抓取 /metrics 中的堆内存指标。结果写入 JSON 报告，可用 --compare
+与之前的报告逐项对比。
+
+Ramps concurrent HTTP pollers and WebSocket subscribers stage by stage, records
+p50/p95/p99 latency, achieved requests per second, time to first byte for "/",
+and server heap usage scraped from /metrics. Writes a JSON report that can be
+diffed against a previous run with --compare.
+
+    pip install websockets
+    python loadgen.py --host 192.168.4.1 --stages 1,2,4,8 --duration 10 --out run.json
+    python loadgen.py --host 192.168.4.1 --out new.json --compare run.json
+
+设备按来源 IP 限流（新建连接每秒 1 个、请求每秒 10 个），压测机的所有连接共用一个额度，
+测到的是限流器而不是服务器；压测前把压测机的 IP 写进固件的 CONFIG_HOME_RATE_LIMIT_EXEMPT。
+The device rate-limits per source IP and every connection from this host shares one
+budget, so add this host's IP to CONFIG_HOME_RATE_LIMIT_EXEMPT before benchmarking.
+"""
+
+import argparse
+import asyncio
+import json
+import math
+import platform
+import re
+import sys
+import time
+
+import websockets
+
+REPORT_VERSION = 1
+
+# 轮询客户端依次请求的接口（与网页首屏加载的接口一致）
+DEFAULT_PATHS = ["/api/live", "/data"]
+
+# 对比时超过该比例的变化才标记出来
+COMPARE_THRESHOLD = 0.10
+
+
+# ---------------------------------------------------------------------------
+# 统计
+# ---------------------------------------------------------------------------
+
+def percentile(sorted_values, p):
+    """最近秩法分位数，输入需已排序"""
+    if not sorted_values:
+        return None
+    rank = max(1, int(round(p / 100.0 * len(sorted_values) + 0.5)))
+    return sorted_values[min(rank, len(sorted_values)) - 1]
+
+
+def summarize(samples_ms):
+    """把一组毫秒延迟汇总为报告中的统计项"""
+    values = sorted(samples_ms)
+    if not values:
+        return {"count": 0}
+    return {
+        "count": len(values),
+        "min_ms": round(values[0], 3),
+        "p50_ms": round(percentile(values, 50), 3),
+        "p95_ms": round(percentile(values, 95), 3),
+        "p99_ms": round(percentile(values, 99), 3),
+        "max_ms": round(values[-1], 3),
+        "mean_ms": round(sum(values) / len(values), 3),
+    }
+
+
+# ---------------------------------------------------------------------------
+# 最小 HTTP/1.1 客户端：直接读 socket，才能准确测到首字节时间
+# ---------------------------------------------------------------------------
+
+class HttpError(Exception):
+    pass
+
+
+class HttpConnection:
+    def __init__(self, host, port, timeout):
+        self.host = host
+        self.port = port
+        self.timeout = timeout
+        self.reader = None
+        self.writer = None
+
+    async def connect(self):
+        self.reader, self.writer = await asyncio.wait_for(
+            asyncio.open_connection(self.host, self.port), self.timeout)
+
+    async def close(self):
+        if self.writer is not None:
+            self.writer.close()
+            try:
+                await self.writer.wait_closed()
+            except (OSError, ConnectionError):
+                pass
+        self.reader = self.writer = None
+
+    async def get(self, path, headers=None):
+        """
+        发送一次 GET，返回 (status, 首字节耗时 ms, 总耗时 ms, body 字节数, 是否保持连接)
+        """
+        lines = [f"GET {path} HTTP/1.1", f"Host: {self.host}", "Connection: keep-alive"]
+        for k, v in (headers or {}).items():
+            lines.append(f"{k}: {v}")
+        request = ("\r\n".join(lines) + "\r\n\r\n").encode()
+
+        # 复用的连接可能已被服务端关闭（LRU 淘汰或空闲超时），此时换新连接重发一次
+        reused = self.writer is not None
+        while True:
+            if self.writer is None:
+                await self.connect()
+            start = time.perf_counter()
+            try:
+                self.writer.write(request)
+                await self.writer.drain()
+                first = await asyncio.wait_for(self.reader.read(1), self.timeout)
+            except (OSError, ConnectionError):
+                first = b""
+            if first:
+                break
+            await self.close()
+            if not reused:
+                raise HttpError("connection closed before response")
+            reused = False
+        ttfb = (time.perf_counter() - start) * 1000.0
+
+        head = first + await asyncio.wait_for(self.reader.readuntil(b"\r\n\r\n"), self.timeout)
+        status_line, _, header_block = head.decode("latin-1").partition("\r\n")
+        parts = status_line.split(" ", 2)
+        if len(parts) < 2 or not parts[0].startswith("HTTP/"):
+            raise HttpError(f"bad status line: {status_line!r}")
+        status = int(parts[1])
+        resp_headers = {}
+        for line in header_block.split("\r\n"):
+            if ":" in line:
+                k, v = line.split(":", 1)
+                resp_headers[k.strip().lower()] = v.strip()
+
+        size = 0
+        if resp_headers.get("transfer-encoding", "").lower() == "chunked":
+            while True:
+                size_line = await asyncio.wait_for(self.reader.readuntil(b"\r\n"), self.timeout)
+                chunk = int(size_line.split(b";")[0].strip() or b"0", 16)
+                await asyncio.wait_for(self.reader.readexactly(chunk + 2), self.timeout)
+                if chunk == 0:
+                    break
+                size += chunk
+        elif "content-length" in resp_headers:
+            size = int(resp_headers["content-length"])
+            if size:
+                await asyncio.wait_for(self.reader.readexactly(size), self.timeout)
+        total = (time.perf_counter() - start) * 1000.0
+
+        keep_alive = resp_headers.get("connection", "").lower() != "close"
+        if not keep_alive:
+            await self.close()
+        return status, ttfb, total, size, keep_alive
+
+
+async def http_get_once(host, port, path, timeout, headers=None):
+    """新建连接发一次请求后关闭"""
+    conn = HttpConnection(host, port, timeout)
+    try:
+        return await conn.get(path, headers)
+    finally:
+        await conn.close()
+
+
+# ---------------------------------------------------------------------------
+# /metrics 抓取
+# ---------------------------------------------------------------------------
+
+METRIC_LINE = re.compile(r'^([a-zA-Z_:][a-zA-Z0-9_:]*)(\{[^}]*\})?\s+([-+0-9.eE]+|NaN|[+-]Inf)$')
+
+
+async def http_fetch(host, port, path, timeout):
+    """短连接读取整个响应正文（支持 chunked）；失败返回 None"""
+    conn = HttpConnection(host, port, timeout)
+    try:
+        await conn.connect()
+        conn.writer.write(f"GET {path} HTTP/1.1\r\nHost: {host}\r\nConnection: close\r\n\r\n".encode())
+        await conn.writer.drain()
+        raw = await asyncio.wait_for(conn.reader.read(-1), timeout)
+    except (OSError, asyncio.TimeoutError, ConnectionError):
+        return None
+    finally:
+        await conn.close()
+
+    head, _, body = raw.partition(b"\r\n\r\n")
+    if not head.startswith(b"HTTP/1.1 200"):
+        return None
+    if b"chunked" in head.lower():
+        out = bytearray()
+        while body:
+            size_line, _, rest = body.partition(b"\r\n")
+            size = int(size_line.split(b";")[0].strip() or b"0", 16)
+            if size == 0:
+                break
+            out += rest[:size]
+            body = rest[size + 2:]
+        body = bytes(out)
+    return body
+
+
+async def scrape_metrics(host, port, timeout):
+    """读取 /metrics，返回 {"name{labels}": value}；失败返回 None"""
+    body = await http_fetch(host, port, "/metrics", timeout)
+    if body is None:
+        return None
+
+    values = {}
+    for line in body.decode("utf-8", "replace").splitlines():
+        m = METRIC_LINE.match(line.strip())
+        if m:
+            values[m.group(1) + (m.group(2) or "")] = float(m.group(3))
+    return values
+
+
+# 稳态下必须不分配堆内存的路径（需固件开启 CONFIG_HOME_ALLOC_CHECK）
+ALLOC_FREE_ROUTES = ["/data", "/api/live", "/ws"]
+
+
+async def check_allocs(args):
+    """读取 /diag/handlers 与 /metrics 中的分配计数，断言稳态路径为 0"""
+    body = await http_fetch(args.host, args.port, "/diag/handlers", args.timeout)
+    metrics = await scrape_metrics(args.host, args.port, args.timeout)
+    if body is None or metrics is None:
+        return {"enabled": False, "passed": False, "error": "cannot read /diag/handlers or /metrics"}
+    handlers = json.loads(body)
+    if not handlers.get("alloc_check"):
+        return {"enabled": False, "passed": False, "error": "firmware built without CONFIG_HOME_ALLOC_CHECK"}
+
+    routes = {r["uri"]: r for r in handlers.get("routes", [])}
+    result = {"enabled": True, "arena_peak": handlers.get("arena_peak"), "routes": {}}
+    passed = True
+    for uri in ALLOC_FREE_ROUTES:
+        r = routes.get(uri)
+        if r is None:
+            continue
+        result["routes"][uri] = {"calls": r.get("count"), "allocs": r.get("allocs")}
+        passed &= r.get("allocs", 0) == 0
+    push = int(metrics.get("home_ws_push_allocs_total", 0))
+    result["ws_push_allocs"] = push
+    passed &= not push
+    result["passed"] = passed
+    return result
+
+
+def heap_snapshot(metrics):
+    """从指标中取出堆内存相关的值"""
+    if metrics is None:
+        return None
+    snap = {}
+    for region in ("internal", "psram"):
+        for key, name in (("free", "home_heap_free_bytes"),
+                          ("largest_block", "home_heap_largest_free_block_bytes"),
+                          ("min_free", "home_heap_minimum_free_bytes")):
+            v = metrics.get(f'{name}{{region="{region}"}}')
+            if v is not None:
+                snap[f"{region}_{key}"] = int(v)
+    return snap
+
+
+# ---------------------------------------------------------------------------
+# 负载客户端
+# ---------------------------------------------------------------------------
+
+class StageResult:
+    def __init__(self):
+        self.http_latency = []
+        self.http_ok = 0
+        self.http_busy = 0
+        self.http_throttled = 0
+        self.http_errors = 0
+        self.http_bytes = 0
+        self.ws_rtt = []
+        self.ws_push = 0
+        self.ws_connected = 0
+        self.ws_errors = 0
+
+
+async def http_poller(args, paths, stop_at, res):
+    """保持连接循环轮询；请求失败时重连"""
+    conn = HttpConnection(args.host, args.port, args.timeout)
+    i = 0
+    try:
+        while time.perf_counter() < stop_at:
+            path = paths[i % len(paths)]
+            i += 1
+            try:
+                status, _, total, size, _ = await conn.get(path)
+            except (OSError, asyncio.TimeoutError, asyncio.IncompleteReadError, ConnectionError, HttpError):
+                res.http_errors += 1
+                await conn.close()
+                await asyncio.sleep(0.05)
+                continue
+            if status == 200 or status == 304:
+                res.http_ok += 1
+                res.http_latency.append(total)
+                res.http_bytes += size
+            elif status == 503:
+                res.http_busy += 1
+            elif status == 429:
+                # 设备按来源 IP 限流，压测机所有连接共用一个额度（压测机未加入免限流列表）
+                res.http_throttled += 1
+            else:
+                res.http_errors += 1
+            if args.poll_interval > 0:
+                await asyncio.sleep(args.poll_interval)
+    finally:
+        await conn.close()
+
+
+async def ws_subscriber(args, stop_at, res):
+    """订阅推送；每隔 ws_get_interval 发一次 "get" 测量往返时间"""
+    # 用 v2 协议连接：v2 推送帧都带 "type"，而 "get" 的回复是不带 "type" 的完整数据，两者才能区分开；
+    # v1 的推送帧与 get 回复格式相同，等待期间到达的推送会被误记成往返时间
+    url = f"ws://{args.host}:{args.port}/ws?v=2"
+    try:
+        async with websockets.connect(url, open_timeout=args.timeout, close_timeout=0.5,
+                                      max_size=None, ping_interval=None) as ws:
+            res.ws_connected += 1
+            while time.perf_counter() < stop_at:
+                sent = time.perf_counter()
+                await ws.send("get")
+                # 推送帧可能先于回复到达：v2 推送帧都带 "type"，不带的文本帧才是对 get 的回复
+                deadline = sent + args.timeout
+                while True:
+                    remaining = deadline - time.perf_counter()
+                    if remaining <= 0:
+                        raise asyncio.TimeoutError()
+                    msg = await asyncio.wait_for(ws.recv(), remaining)
+                    if isinstance(msg, str) and '"type"' not in msg:
+                        res.ws_rtt.append((time.perf_counter() - sent) * 1000.0)
+                        break
+                    res.ws_push += 1
+                # 等待期间继续接收推送帧
+                wait_until = min(stop_at, time.perf_counter() + args.ws_get_interval)
+                while True:
+                    remaining = wait_until - time.perf_counter()
+                    if remaining <= 0:
+                        break
+                    try:
+                        await asyncio.wait_for(ws.recv(), remaining)
+                        res.ws_push += 1
+                    except asyncio.TimeoutError:
+                        break
+    except (OSError, asyncio.TimeoutError, websockets.exceptions.WebSocketException):
+        res.ws_errors += 1
+
+
+async def measure_ttfb(args):
+    """新连接上请求 "/" 的首字节时间（从发出请求算起），顺序执行，不与负载叠加"""
+    samples = []
+    errors = 0
+    headers = {"Accept-Encoding": "br, gzip"}
+    for _ in range(args.ttfb_samples):
+        try:
+            status, ttfb, _, _, _ = await http_get_once(args.host, args.port, "/", args.timeout, headers)
+        except (OSError, asyncio.TimeoutError, asyncio.IncompleteReadError, ConnectionError, HttpError):
+            errors += 1
+            continue
+        if status == 200:
+            samples.append(ttfb)
+        else:
+            errors += 1
+    summary = summarize(samples)
+    summary["errors"] = errors
+    return summary
+
+
+async def run_stage(args, level):
+    res = StageResult()
+    before = heap_snapshot(await scrape_metrics(args.host, args.port, args.timeout))
+
+    start = time.perf_counter()
+    stop_at = start + args.duration
+    tasks = []
+    for _ in range(level):
+        tasks.append(asyncio.create_task(http_poller(args, args.paths, stop_at, res)))
+    for _ in range(math.ceil(level * args.ws_ratio)):
+        tasks.append(asyncio.create_task(ws_subscriber(args, stop_at, res)))
+    await asyncio.gather(*tasks)
+    elapsed = time.perf_counter() - start
+
+    after = heap_snapshot(await scrape_metrics(args.host, args.port, args.timeout))
+
+    http = summarize(res.http_latency)
+    http.update({
+        "ok": res.http_ok,
+        "busy_503": res.http_busy,
+        "throttled_429": res.http_throttled,
+        "errors": res.http_errors,
+        "rps": round(res.http_ok / elapsed, 2) if elapsed > 0 else 0,
+        "bytes": res.http_bytes,
+    })
+    ws = summarize(res.ws_rtt)
+    ws.update({
+        "subscribers": math.ceil(level * args.ws_ratio),
+        "connected": res.ws_connected,
+        "errors": res.ws_errors,
+        "push_frames": res.ws_push,
+    })
+    return {
+        "concurrency": level,
+        "elapsed_s": round(elapsed, 3),
+        "http": http,
+        "ws_rtt": ws,
+        "heap_before": before,
+        "heap_after": after,
+    }
+
+
+# ---------------------------------------------------------------------------
+# 报告
+# ---------------------------------------------------------------------------
+
+def print_stage(stage):
+    h = stage["http"]
+    w = stage["ws_rtt"]
+    heap = stage["heap_after"] or {}
+    print(f"  并发 {stage['concurrency']:>3}: "
+          f"HTTP {h.get('rps', 0):>7.1f} req/s  p50 {h.get('p50_ms', '-')}  p95 {h.get('p95_ms', '-')}  "
+          f"p99 {h.get('p99_ms', '-')} ms  503 {h['busy_503']}  429 {h.get('throttled_429', 0)}  err {h['errors']} | "
+          f"WS {w['connected']}/{w['subscribers']} rtt p50 {w.get('p50_ms', '-')} p99 {w.get('p99_ms', '-')} ms | "
+          f"heap free {heap.get('internal_free', '-')}")
+
+
+def compare_reports(old, new):
+    """逐阶段对比关键指标，变化超过阈值的行加标记；返回是否有退化"""
+    regressed = False
+
+    def row(label, a, b, lower_is_better=True):
+        nonlocal regressed
+        if a is None or b is None:
+            return
+        mark = ""
+        if a:
+            change = (b - a) / a
+            worse = change > COMPARE_THRESHOLD if lower_is_better else change < -COMPARE_THRESHOLD
+            better = change < -COMPARE_THRESHOLD if lower_is_better else change > COMPARE_THRESHOLD
+            mark = "  <-- 退化 / regression" if worse else ("  (改善 / improved)" if better else "")
+            regressed |= worse
+            print(f"    {label:<16} {a:>10} -> {b:<10} {change * 100:+6.1f}%{mark}")
+        else:
+            print(f"    {label:<16} {a:>10} -> {b:<10}")
+
+    print("\n对比 / Compare")
+    print("  TTFB /")
+    for key in ("p50_ms", "p95_ms", "p99_ms"):
+        row(key, old["ttfb"].get(key), new["ttfb"].get(key))
+
+    old_stages = {s["concurrency"]: s for s in old.get("stages", [])}
+    for stage in new.get("stages", []):
+        prev = old_stages.get(stage["concurrency"])
+        if prev is None:
+            continue
+        print(f"  并发 {stage['concurrency']}")
+        row("http rps", prev["http"].get("rps"), stage["http"].get("rps"), lower_is_better=False)
+        for key in ("p50_ms", "p95_ms", "p99_ms"):
+            row("http " + key, prev["http"].get(key), stage["http"].get(key))
+        for key in ("p50_ms", "p99_ms"):
+            row("ws " + key, prev["ws_rtt"].get(key), stage["ws_rtt"].get(key))
+        a = (prev.get("heap_after") or {}).get("internal_min_free")
+        b = (stage.get("heap_after") or {}).get("internal_min_free")
+        row("heap min free", a, b, lower_is_better=False)
+    return regressed
+
+
+async def main_async(args):
+    print(f"目标 / Target: {args.host}:{args.port}")
+    metrics = await scrape_metrics(args.host, args.port, args.timeout)
+    if metrics is None:
+        print("❌ 无法读取 /metrics，请检查 --host（Windows 上 esp.local 常不可用，可改用设备 IP）")
+        return None
+
+    report = {
+        "version": REPORT_VERSION,
+        "started_at": time.strftime("%Y-%m-%dT%H:%M:%S%z"),
+        "target": f"{args.host}:{args.port}",
+        "label": args.label,
+        "client": {"python": platform.python_version(), "platform": platform.platform()},
+        "config": {
+            "stages": args.stages,
+            "duration_s": args.duration,
+            "ws_ratio": args.ws_ratio,
+            "paths": args.paths,
+            "poll_interval_s": args.poll_interval,
+            "ws_get_interval_s": args.ws_get_interval,
+            "ttfb_samples": args.ttfb_samples,
+        },
+        "server_uptime_s": metrics.get("home_uptime_seconds"),
+        "heap_start": heap_snapshot(metrics),
+    }
+
+    print(f"\n[TTFB] GET / x{args.ttfb_samples}")
+    report["ttfb"] = await measure_ttfb(args)
+    t = report["ttfb"]
+    print(f"  p50 {t.get('p50_ms', '-')}  p95 {t.get('p95_ms', '-')}  p99 {t.get('p99_ms', '-')} ms  err {t['errors']}")
+
+    print(f"\n[Ramp] 每阶段 {args.duration}s / {args.duration}s per stage")
+    report["stages"] = []
+    for level in args.stages:
+        stage = await run_stage(args, level)
+        report["stages"].append(stage)
+        print_stage(stage)
+        # 让服务端回收上一阶段的连接
+        await asyncio.sleep(args.settle)
+
+    if t["errors"] or any(s["http"].get("throttled_429") for s in report["stages"]):
+        print("\n  ⚠️  出现 429 或新建连接失败：压测机可能被限流，结果反映的是限流额度而非服务器能力；"
+              "请把本机 IP 加入 CONFIG_HOME_RATE_LIMIT_EXEMPT\n"
+              "     429s or failed connections: this host is probably being rate-limited, so the numbers "
+              "reflect the limiter budget; add its IP to CONFIG_HOME_RATE_LIMIT_EXEMPT")
+
+    report["heap_end"] = heap_snapshot(await scrape_metrics(args.host, args.port, args.timeout))
+
+    if args.check_allocs:
+        check = await check_allocs(args)
+        report["alloc_check"] = check
+        print("\n[Alloc] 稳态路径堆分配 / steady-state heap allocations")
+        if not check["enabled"]:
+            print(f"  ❌ {check['error']}")
+        else:
+            for uri, r in check["routes"].items():
+                print(f"  {uri:<10} calls {r['calls']:>6}  allocs {r['allocs']}")
+            print(f"  ws push    allocs {check['ws_push_allocs']}")
+            print("  ✅ 通过 / passed" if check["passed"] else "  ❌ 存在堆分配 / allocations found")
+    return report
+
+
+def parse_args():
+    p = argparse.ArgumentParser(description="Load generator for the temperature/humidity web server")
+    p.add_argument("--host", default="esp.local", help="设备地址 / device address (default: esp.local)")
+    p.add_argument("--port", type=int, default=80)
+    p.add_argument("--stages", default="1,2,4,8",
+                   help="逐级并发的 HTTP 轮询客户端数，逗号分隔 / comma-separated concurrency levels")
+    p.add_argument("--duration", type=float, default=10.0, help="每阶段秒数 / seconds per stage")
+    p.add_argument("--settle", type=float, default=2.0, help="阶段之间的间隔秒数 / pause between stages")
+    p.add_argument("--ws-ratio", type=float, default=0.5,
+                   help="每个 HTTP 轮询客户端对应的 WS 订阅者数 / WS subscribers per HTTP poller")
+    p.add_argument("--paths", default=",".join(DEFAULT_PATHS), help="轮询的接口 / polled endpoints")
+    p.add_argument("--poll-interval", type=float, default=0.0,
+                   help="轮询间隔秒数，0 为尽快 / delay between polls, 0 = closed loop")
+    p.add_argument("--ws-get-interval", type=float, default=1.0, help="WS get 往返测量间隔 / seconds between WS RTT probes")
+    p.add_argument("--ttfb-samples", type=int, default=20)
+    p.add_argument("--timeout", type=float, default=5.0)
+    p.add_argument("--label", default="", help="写进报告的备注（如固件版本）/ free-form label stored in the report")
+    p.add_argument("--out", default="loadgen_report.json", help="JSON 报告路径 / report path")
+    p.add_argument("--compare", help="与之前的报告对比 / previous report to diff against")
+    p.add_argument("--check-allocs", action="store_true",
+                   help="断言 /data、/api/live、/ws 与推送在稳态下零堆分配（需 CONFIG_HOME_ALLOC_CHECK）"
+                        " / assert zero heap allocations on steady-state paths")
+    args = p.parse_args()
+    args.stages = [int(s) for s in args.stages.split(",") if s.strip()]
+    args.paths = [s.strip() for s in args.paths.split(",") if s.strip()]
+    return args
+
+
+def main():
+    args = parse_args()
+    report = asyncio.run(main_async(args))
+    if report is None:
+        return 2
+
+    with open(args.out, "w", encoding="utf-8") as f:
+        json.dump(report, f, indent=2, ensure_ascii=False)
+    print(f"\n报告已写入 / Report written to {args.out}")
+
+    failed = args.check_allocs and not report["alloc_check"]["passed"]
+    if args.compare:
+        with open(args.compare, encoding="utf-8") as f:
+            old = json.load(f)
+        if old.get("version") != REPORT_VERSION:
+            print("⚠️ 报告版本不同，跳过对比 / report version mismatch, skipping compare")
+            return 1 if failed else 0
+        failed |= compare_reports(old, report)
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -8,6 +8,7 @@
 #include "ap.h" // 包含AP头文件
 #include "data_process.h" // 包含DHT11头文件
 #include "my_mdns.h" // 包含mDNS头文件
+#include "settings.h" // 包含设置服务头文件
 
 // 主函数
 void app_main()
@@ -16,6 +17,8 @@ void app_main()
     ESP_ERROR_CHECK(nvs_flash_init());
     // 初始化软AP
     wifi_init_softap();
+    // 加载设置（报警阈值）并启动设置任务
+    settings_init();
     // 启动web服务器
     start_webserver();
 